@@ -19,48 +19,121 @@
 #include "graph.h"
 #include "CA.h"
 
-VEC(long) *get_ancestors(const struct graph *gi, long node)
-{
-     long i, n;
-     VEC(long) *ancs;
-     long *pred;
-     long *discovered;
-     long *finished;
-
-     ancs = (VEC(long) *)xmalloc(sizeof(VEC(long)));
-     n = gi->n_nodes;
-     pred = (long *)xcalloc(n, sizeof(long));
-     discovered = (long *)xcalloc(n, sizeof(long));
-     finished = (long *)xcalloc(n, sizeof(long));
-     VEC_INIT(long, *ancs);
-     VEC_PUSH(long, *ancs, node);
-
-     dfs_search(gi, node, discovered, finished, pred);
-     for (i = 0; i < n; i++) {
-	  if (pred[i] != -1) {
-	       VEC_PUSH(long, *ancs, i);
+#ifdef SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+#define INFTY    INT_MAX
+#define GALLOP_RATIO  32
+#define ID_CMP(a, b) (((a) > (b)) - ((a) < (b)))
+
+VEC_INIT_QSORT(long, ancestors, ID_CMP)
+
+void init_ancestors_ws(struct ancestors_ws *ws, long n)
+{
+     init_search_ctx(&ws->sc, n);
+     VEC_INIT(long, ws->order);
+}
+
+void free_ancestors_ws(struct ancestors_ws *ws)
+{
+     free_search_ctx(&ws->sc);
+     VEC_DESTROY(ws->order);
+}
+
+/**
+ * Ancestors of node with its shortest distances. The ancestors are
+ * the nodes reachable from node in the inverse graph gi. The
+ * distances are relaxed in the reverse postorder of the search,
+ * which is a topological order of the ancestors in gi. The search
+ * context of ws only costs the entries of the ancestors.
+ */
+struct ancestors *get_ancestors_ws(const struct csr_graph *gi, long node,
+				   struct ancestors_ws *ws)
+{
+     long i, k, n, u, v, c;
+     struct ancestors *ancs;
+     long *dist;
+
+     dfs_postorder(gi, node, &ws->sc, &ws->order);
+     dist = ws->sc.val;
+     n = VEC_SIZE(ws->order);
+     for (i = 0; i < n; i++)
+	  dist[VEC_GET(ws->order, i)] = INFTY;
+     dist[node] = 0;
+     for (i = n-1; i >= 0; i--) {
+	  u = VEC_GET(ws->order, i);
+	  csr_for_each_out(k, gi, u) {
+	       v = gi->out_to[k];
+	       c = dist[u] + gi->out_cost[k];
+	       if (c < dist[v])
+		    dist[v] = c;
 	  }
      }
-     free(pred);
-     free(discovered);
-     free(finished);
+
+     ancs = (struct ancestors *)xmalloc(sizeof(struct ancestors));
+     VEC_QSORT(ws->order, ancestors);
+     VEC_INIT_N(long, ancs->node, n);
+     VEC_INIT_N(long, ancs->dist, n);
+     for (i = 0; i < n; i++) {
+	  u = VEC_GET(ws->order, i);
+	  VEC_PUSH_FAST(ancs->node, u);
+	  VEC_PUSH_FAST(ancs->dist, dist[u]);
+     }
+
+     return ancs;
+}
+
+struct ancestors *get_ancestors(const struct csr_graph *gi, long node)
+{
+     struct ancestors *ancs;
+     struct ancestors_ws ws;
+
+     init_ancestors_ws(&ws, gi->n_nodes);
+     ancs = get_ancestors_ws(gi, node, &ws);
+     free_ancestors_ws(&ws);
 
      return ancs;
 }
 
-VEC(long) **get_all_ancestors(const struct graph *g)
+void free_ancestors(struct ancestors *a)
 {
-     long i, j, n;
+     VEC_DESTROY(a->node);
+     VEC_DESTROY(a->dist);
+     free(a);
+}
+
+/**
+ * Shortest distance from the ancestor v to the node of a, -1 if v is
+ * not an ancestor
+ */
+long ancestor_dist(const struct ancestors *a, long v)
+{
+     long lo, hi, mid;
+
+     lo = 0;
+     hi = VEC_SIZE(a->node);
+     while (lo < hi) {
+	  mid = lo + (hi - lo)/2;
+	  if (VEC_GET(a->node, mid) < v)
+	       lo = mid + 1;
+	  else
+	       hi = mid;
+     }
+     if ((lo < (long)VEC_SIZE(a->node)) && (VEC_GET(a->node, lo) == v))
+	  return VEC_GET(a->dist, lo);
+     return -1;
+}
+
+VEC(long) **get_all_ancestors(const struct csr_graph *g)
+{
+     long i, j, n, m;
      VEC(long) **all_a;
-     long *pred;
-     long *discovered;
-     long *finished;
+     struct search_ctx sc;
 
      n = g->n_nodes;
-     all_a = xmalloc(n*sizeof(VEC(long)));
-     pred = (long *)xcalloc(n, sizeof(long));
-     discovered = (long *)xcalloc(n, sizeof(long));
-     finished = (long *)xcalloc(n, sizeof(long));
+     all_a = xmalloc(n*sizeof(VEC(long) *));
+     init_search_ctx(&sc, n);
      for (i = 0; i < n; i++) {
 	  all_a[i] = (VEC(long) *)xmalloc(sizeof(VEC(long)));
 	  VEC_INIT(long, *all_a[i]);
@@ -69,75 +142,290 @@ VEC(long) **get_all_ancestors(const struct graph *g)
      /*	printf("** Start Search Ancestors ** \n\n");*/
      for (i = 0; i < n; i++) {
 	  fprintf(stderr, "** Search in %ld  ** \n", i);
-	  dfs_search(g, i, discovered, finished, pred);
-	  for (j = 0; j < n; j++) {
-	       if (pred[j] != -1) {
-		    VEC_PUSH(long, *all_a[j], i);
+	  dfs_search(g, i, &sc);
+	  m = VEC_SIZE(sc.touched);
+	  for (j = 0; j < m; j++) {
+	       if (search_ctx_pred(&sc, VEC_GET(sc.touched, j)) != -1) {
+		    VEC_PUSH(long, *all_a[VEC_GET(sc.touched, j)], i);
 	       }
 	  }
      }
-     free(pred);
-     free(discovered);
-     free(finished);
+     free_search_ctx(&sc);
 
      return all_a;
 }
 
-long LCA_CA(VEC(long) *lx, VEC(long) *ly, long *depth)
+/*
+ * Intersection of ancestor lists. Both lists are sorted by id and the
+ * common ancestors are visited in increasing order of id, so the LCA
+ * is the first node of maximum depth, as in the previous nested loops.
+ */
+
+struct lca_state {
+     long max;
+     long lca;
+     long dax;
+     long day;
+     VEC(long) *set;
+};
+
+static inline void lca_update(struct lca_state *st, const long *depth,
+			      long v, long dx, long dy)
 {
-     long i, j, nlx, nly, vx;
-     long max, lca;
+     if (depth[v] > st->max) {
+	  st->max = depth[v];
+	  st->lca = v;
+	  st->dax = dx;
+	  st->day = dy;
+	  if (st->set) {
+	       VEC_CLEAR(*st->set);
+	       VEC_PUSH(long, *st->set, v);
+	  }
+     } else if (st->set && (depth[v] == st->max)) {
+	  VEC_PUSH(long, *st->set, v);
+     }
+}
 
-     max = -1;
-     lca = -1;
-     nlx = VEC_SIZE(*lx);
-     nly = VEC_SIZE(*ly);
-     for (i = 0; i < nlx; i++) {
-	  vx = VEC_GET(*lx, i);
-	  for (j = 0; j < nly; j++) {
-	       if ((vx == VEC_GET(*ly, j)) && (depth[vx] > max)) {
-		    max = depth[vx];
-		    lca = vx;
-	       }
+/**
+ * Linear merge of a[i..na-1] and b[j..nb-1]
+ */
+static void merge_scalar(const struct ancestors *a, long i, const struct ancestors *b,
+			 long j, const long *depth, struct lca_state *st)
+{
+     long na, nb, va, vb;
+
+     na = VEC_SIZE(a->node);
+     nb = VEC_SIZE(b->node);
+     while ((i < na) && (j < nb)) {
+	  va = VEC_GET(a->node, i);
+	  vb = VEC_GET(b->node, j);
+	  if (va == vb) {
+	       lca_update(st, depth, va, VEC_GET(a->dist, i), VEC_GET(b->dist, j));
+	       i++;
+	       j++;
+	  } else if (va < vb) {
+	       i++;
+	  } else {
+	       j++;
 	  }
      }
-     if (lca == -1)
-	  fatal("Error with the lowest common ancestor");
-     return lca;
 }
 
-VEC(long) *LCA_CA_SET(VEC(long) *lx, VEC(long) *ly, long *depth)
+/**
+ * Intersection of a small list with a large one. Each element of the
+ * small list is searched in the large one with an exponential search
+ * followed by a binary search from the last position found.
+ */
+static void merge_galloping(const struct ancestors *small, const struct ancestors *large,
+			    bool swapped, const long *depth, struct lca_state *st)
 {
-     long i, j, nlx, nly, vx, max, lcam;
-     VEC(long) *lca;
+     long i, j, lo, hi, step, mid, ns, nl, v;
+     const long *ids;
 
-     lca = (VEC(long) *)xmalloc(sizeof(VEC(long)));
-     VEC_INIT(long, *lca);
+     ns = VEC_SIZE(small->node);
+     nl = VEC_SIZE(large->node);
+     ids = large->node.data;
+     j = 0;
+     for (i = 0; (i < ns) && (j < nl); i++) {
+	  v = VEC_GET(small->node, i);
+	  step = 1;
+	  lo = j;
+	  hi = j;
+	  while ((hi < nl) && (ids[hi] < v)) {
+	       lo = hi + 1;
+	       hi += step;
+	       step <<= 1;
+	  }
+	  if (hi >= nl)
+	       hi = nl - 1;
+	  while (lo < hi) {
+	       mid = lo + (hi - lo) / 2;
+	       if (ids[mid] < v)
+		    lo = mid + 1;
+	       else
+		    hi = mid;
+	  }
+	  j = lo;
+	  if ((j < nl) && (ids[j] == v)) {
+	       if (swapped)
+		    lca_update(st, depth, v, VEC_GET(large->dist, j), VEC_GET(small->dist, i));
+	       else
+		    lca_update(st, depth, v, VEC_GET(small->dist, i), VEC_GET(large->dist, j));
+	       j++;
+	  }
+     }
+}
+
+#ifdef SIMD_DISPATCH
+
+/**
+ * Merge by blocks of four ids. Every block of a is compared against
+ * the four rotations of the current block of b, and the block with the
+ * smallest last id is advanced. The tail is merged with merge_scalar.
+ */
+TARGET("avx2")
+static void merge_avx2(const struct ancestors *a, const struct ancestors *b,
+		       const long *depth, struct lca_state *st)
+{
+     long i, j, k, l, na, nb, amax, bmax;
+     const long *ida, *idb;
+     __m256i va, vb, m;
+     int mask;
 
-     max = -1;
-     lcam = -1;
-     nlx = VEC_SIZE(*lx);
-     nly = VEC_SIZE(*ly);
-     for (i = 0; i < nlx; i++) {
-	  vx = VEC_GET(*lx, i);
-	  for (j = 0; j < nly; j++) {
-	       if ((vx == VEC_GET(*ly, j)) && (depth[vx] > max)) {
-		    max = depth[vx];
-		    lcam = vx;
+     na = VEC_SIZE(a->node);
+     nb = VEC_SIZE(b->node);
+     ida = a->node.data;
+     idb = b->node.data;
+     i = 0;
+     j = 0;
+     while ((i + 4 <= na) && (j + 4 <= nb)) {
+	  va = _mm256_loadu_si256((const __m256i *)(ida + i));
+	  vb = _mm256_loadu_si256((const __m256i *)(idb + j));
+	  m = _mm256_cmpeq_epi64(va, vb);
+	  vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+	  m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, vb));
+	  vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+	  m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, vb));
+	  vb = _mm256_permute4x64_epi64(vb, _MM_SHUFFLE(0, 3, 2, 1));
+	  m = _mm256_or_si256(m, _mm256_cmpeq_epi64(va, vb));
+	  mask = _mm256_movemask_pd(_mm256_castsi256_pd(m));
+	  for (l = 0; mask != 0; l++, mask >>= 1) {
+	       if (mask & 1) {
+		    for (k = j; idb[k] != ida[i+l]; k++)
+			 ;
+		    lca_update(st, depth, ida[i+l], VEC_GET(a->dist, i+l), VEC_GET(b->dist, k));
 	       }
 	  }
+	  amax = ida[i+3];
+	  bmax = idb[j+3];
+	  if (amax <= bmax)
+	       i += 4;
+	  if (bmax <= amax)
+	       j += 4;
      }
+     merge_scalar(a, i, b, j, depth, st);
+}
 
-     if (lcam == -1)
-	  fatal("Error with the lowest common ancestor");
+/**
+ * Merge by blocks of two ids, as the AVX2 version with blocks of four.
+ */
+TARGET("sse4.1")
+static void merge_sse41(const struct ancestors *a, const struct ancestors *b,
+		       const long *depth, struct lca_state *st)
+{
+     long i, j, k, l, na, nb, amax, bmax;
+     const long *ida, *idb;
+     __m128i va, vb, m;
+     int mask;
 
-     for (i = 0; i < nlx;  i++) {
-	  vx = VEC_GET(*lx,  i);
-	  for (j = 0; j < nly; j++) {
-	       if ((vx == VEC_GET(*ly, j)) && (depth[vx] == max)) {
-		    VEC_PUSH(long, *lca, vx);
+     na = VEC_SIZE(a->node);
+     nb = VEC_SIZE(b->node);
+     ida = a->node.data;
+     idb = b->node.data;
+     i = 0;
+     j = 0;
+     while ((i + 2 <= na) && (j + 2 <= nb)) {
+	  va = _mm_loadu_si128((const __m128i *)(ida + i));
+	  vb = _mm_loadu_si128((const __m128i *)(idb + j));
+	  m = _mm_cmpeq_epi64(va, vb);
+	  vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(1, 0, 3, 2));
+	  m = _mm_or_si128(m, _mm_cmpeq_epi64(va, vb));
+	  mask = _mm_movemask_pd(_mm_castsi128_pd(m));
+	  for (l = 0; mask != 0; l++, mask >>= 1) {
+	       if (mask & 1) {
+		    for (k = j; idb[k] != ida[i+l]; k++)
+			 ;
+		    lca_update(st, depth, ida[i+l], VEC_GET(a->dist, i+l), VEC_GET(b->dist, k));
 	       }
 	  }
+	  amax = ida[i+1];
+	  bmax = idb[j+1];
+	  if (amax <= bmax)
+	       i += 2;
+	  if (bmax <= amax)
+	       j += 2;
      }
+     merge_scalar(a, i, b, j, depth, st);
+}
+
+#endif
+
+/**
+ * The widest merge supported by the running CPU
+ */
+static void merge_simd(const struct ancestors *a, const struct ancestors *b,
+		       const long *depth, struct lca_state *st)
+{
+#ifdef SIMD_DISPATCH
+     if (__builtin_cpu_supports("avx2"))
+	  merge_avx2(a, b, depth, st);
+     else if (__builtin_cpu_supports("sse4.1"))
+	  merge_sse41(a, b, depth, st);
+     else
+	  merge_scalar(a, 0, b, 0, depth, st);
+#else
+     merge_scalar(a, 0, b, 0, depth, st);
+#endif
+}
+
+/**
+ * One pass over the common ancestors of ax and ay. The galloping
+ * search is used when one list is much larger than the other one.
+ */
+static void common_ancestors(const struct ancestors *ax, const struct ancestors *ay,
+			     const long *depth, struct lca_state *st)
+{
+     long nx, ny;
+
+     st->max = -1;
+     st->lca = -1;
+     st->dax = 0;
+     st->day = 0;
+     nx = VEC_SIZE(ax->node);
+     ny = VEC_SIZE(ay->node);
+     if (nx * GALLOP_RATIO < ny)
+	  merge_galloping(ax, ay, false, depth, st);
+     else if (ny * GALLOP_RATIO < nx)
+	  merge_galloping(ay, ax, true, depth, st);
+     else
+	  merge_simd(ax, ay, depth, st);
+     if (st->lca == -1)
+	  fatal("Error with the lowest common ancestor");
+}
+
+long LCA_CA(const struct ancestors *ax, const struct ancestors *ay,
+	    const long *depth, long *dax, long *day)
+{
+     struct lca_state st;
+
+     st.set = NULL;
+     common_ancestors(ax, ay, depth, &st);
+     *dax = st.dax;
+     *day = st.day;
+
+     return st.lca;
+}
+
+/**
+ * The set of lowest common ancestors of ax and ay. The LCA returned
+ * by LCA_CA and its distances are also given in lcap, dax and day.
+ */
+VEC(long) *LCA_CA_SET(const struct ancestors *ax, const struct ancestors *ay,
+		      const long *depth, long *lcap, long *dax, long *day)
+{
+     struct lca_state st;
+     VEC(long) *lca;
+
+     lca = (VEC(long) *)xmalloc(sizeof(VEC(long)));
+     VEC_INIT(long, *lca);
+     st.set = lca;
+     common_ancestors(ax, ay, depth, &st);
+     if (lcap)
+	  *lcap = st.lca;
+     if (dax)
+	  *dax = st.dax;
+     if (day)
+	  *day = st.day;
+
      return lca;
 }
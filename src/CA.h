@@ -9,12 +9,45 @@
 #ifndef ___CA_H
 #define ___CA_H
 
-VEC(long) *get_ancestors(const struct graph *gi, long node);
+/**
+ * Ancestors of a node, including the node itself, sorted by id.
+ * VEC_GET(dist, i) is the length of the shortest path from
+ * VEC_GET(node, i) to the node.
+ */
+struct ancestors {
+  VEC(long) node;
+  VEC(long) dist;
+};
+
+/**
+ * Search context and postorder buffer used to build the ancestors of
+ * a node. A workspace is owned by one thread and reused by all its
+ * searches.
+ */
+struct ancestors_ws {
+  struct search_ctx sc;
+  VEC(long) order;
+};
+
+void init_ancestors_ws(struct ancestors_ws *ws, long n);
+
+void free_ancestors_ws(struct ancestors_ws *ws);
+
+struct ancestors *get_ancestors_ws(const struct csr_graph *gi, long node,
+                                   struct ancestors_ws *ws);
+
+struct ancestors *get_ancestors(const struct csr_graph *gi, long node);
+
+void free_ancestors(struct ancestors *a);
+
+long ancestor_dist(const struct ancestors *a, long v);
 
-VEC(long) **get_all_ancestors(const struct graph *g);
+VEC(long) **get_all_ancestors(const struct csr_graph *g);
 
-long LCA_CA(VEC(long) *lx, VEC(long) *ly, long *depth);
+long LCA_CA(const struct ancestors *ax, const struct ancestors *ay,
+            const long *depth, long *dax, long *day);
 
-VEC(long) *LCA_CA_SET(VEC(long) *lx, VEC(long) *ly, long *depth);
+VEC(long) *LCA_CA_SET(const struct ancestors *ax, const struct ancestors *ay,
+                      const long *depth, long *lcap, long *dax, long *day);
 
 #endif /* ___CA_H */
@@ -0,0 +1,241 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief All pairs shortest paths with a blocked Floyd-Warshall
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <limits.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "apsp.h"
+
+#define INFTY    INT_MAX
+
+struct apsp_args {
+  struct dist_matrix *m;
+  pthread_barrier_t *barrier;
+  unsigned id;
+  unsigned n_threads;
+};
+
+static void init_dist_matrix(struct dist_matrix *m, long n)
+{
+  long i, size;
+
+  m->n = n;
+  m->ld = ((n + APSP_TILE - 1)/APSP_TILE)*APSP_TILE;
+  m->nodes = NULL;
+  size = m->ld*m->ld;
+  m->d = (long *)xmalloc((size > 0 ? size : 1)*sizeof(long));
+  for (i = 0; i < size; i++) {
+    m->d[i] = INFTY;
+  }
+  for (i = 0; i < m->ld; i++) {
+    m->d[i*m->ld + i] = 0;
+  }
+}
+
+void free_dist_matrix(struct dist_matrix *m)
+{
+  free(m->d);
+  free(m->nodes);
+  m->d = NULL;
+  m->nodes = NULL;
+  m->n = 0;
+  m->ld = 0;
+}
+
+static inline void set_arc(struct dist_matrix *m, long i, long j, long cost)
+{
+  if (cost < m->d[i*m->ld + j])
+    m->d[i*m->ld + j] = cost;
+}
+
+/**
+ * c[j] = min(c[j], a + b[j]) for the APSP_TILE entries of a row.
+ * The sums never overflow, since the entries are at most INFTY.
+ */
+static inline void min_plus_row(long *c, const long *b, long a)
+{
+  long j;
+#if defined(__AVX2__)
+  __m256i va, vb, vc, s;
+
+  va = _mm256_set1_epi64x(a);
+  for (j = 0; j < APSP_TILE; j += 4) {
+    vb = _mm256_loadu_si256((const __m256i *)(b + j));
+    vc = _mm256_loadu_si256((const __m256i *)(c + j));
+    s = _mm256_add_epi64(va, vb);
+    vc = _mm256_blendv_epi8(vc, s, _mm256_cmpgt_epi64(vc, s));
+    _mm256_storeu_si256((__m256i *)(c + j), vc);
+  }
+#else
+  for (j = 0; j < APSP_TILE; j++) {
+    if (a + b[j] < c[j])
+      c[j] = a + b[j];
+  }
+#endif
+}
+
+/**
+ * Relax the tile c through the tiles a (same rows) and b (same columns)
+ * with k as the outer loop, so it is also correct when c is a or b.
+ */
+static void fw_tile(long *c, const long *a, const long *b, long ld)
+{
+  long i, k, aik;
+
+  for (k = 0; k < APSP_TILE; k++) {
+    for (i = 0; i < APSP_TILE; i++) {
+      aik = a[i*ld + k];
+      if (aik == INFTY)
+        continue;
+      min_plus_row(c + i*ld, b + k*ld, aik);
+    }
+  }
+}
+
+static inline long *tile(struct dist_matrix *m, long ti, long tj)
+{
+  return m->d + (ti*m->ld + tj)*APSP_TILE;
+}
+
+/**
+ * For each tile kb of the diagonal: the tile itself, then the tiles of
+ * its row and column, then the rest. The tiles of a phase are split
+ * between the threads, which wait for each other between the phases.
+ */
+static void *apsp_worker(void *args)
+{
+  struct apsp_args *aa;
+  struct dist_matrix *m;
+  long kb, q, t, ti, tj, nt;
+
+  aa = (struct apsp_args *)args;
+  m = aa->m;
+  nt = m->ld/APSP_TILE;
+  for (kb = 0; kb < nt; kb++) {
+    if (aa->id == 0)
+      fw_tile(tile(m, kb, kb), tile(m, kb, kb), tile(m, kb, kb), m->ld);
+    pthread_barrier_wait(aa->barrier);
+    for (q = aa->id; q < 2*nt; q += aa->n_threads) {
+      t = q/2;
+      if (t == kb)
+        continue;
+      if (q % 2 == 0)
+        fw_tile(tile(m, kb, t), tile(m, kb, kb), tile(m, kb, t), m->ld);
+      else
+        fw_tile(tile(m, t, kb), tile(m, t, kb), tile(m, kb, kb), m->ld);
+    }
+    pthread_barrier_wait(aa->barrier);
+    for (q = aa->id; q < nt*nt; q += aa->n_threads) {
+      ti = q/nt;
+      tj = q%nt;
+      if ((ti == kb) || (tj == kb))
+        continue;
+      fw_tile(tile(m, ti, tj), tile(m, ti, kb), tile(m, kb, tj), m->ld);
+    }
+    pthread_barrier_wait(aa->barrier);
+  }
+  return NULL;
+}
+
+static void floyd_warshall(struct dist_matrix *m, unsigned n_threads)
+{
+  struct apsp_args args[n_threads];
+  pthread_t thread[n_threads];
+  pthread_barrier_t barrier;
+  unsigned i;
+  int tc;
+
+  tc = pthread_barrier_init(&barrier, NULL, n_threads);
+  if (tc)
+    fatal("ERROR; return code from pthread_barrier_init() is %d\n", tc);
+  for (i = 0; i < n_threads; i++) {
+    args[i].m = m;
+    args[i].barrier = &barrier;
+    args[i].id = i;
+    args[i].n_threads = n_threads;
+  }
+  for (i = 1; i < n_threads; i++) {
+    tc = pthread_create(&thread[i], NULL, apsp_worker, (void *)(&args[i]));
+    if (tc)
+      fatal("ERROR; return code from pthread_create() is %d\n", tc);
+  }
+  apsp_worker((void *)(&args[0]));
+  for (i = 1; i < n_threads; i++) {
+    tc = pthread_join(thread[i], NULL);
+    if (tc)
+      fatal("ERROR; return code from pthread_join() is %d\n", tc);
+  }
+  pthread_barrier_destroy(&barrier);
+}
+
+/**
+ * Shortest distances between all the nodes of g, using n_threads threads
+ */
+void apsp_all(const struct csr_graph *g, struct dist_matrix *m, unsigned n_threads)
+{
+  long u, k;
+
+  init_dist_matrix(m, g->n_nodes);
+  for (u = 0; u < g->n_nodes; u++) {
+    csr_for_each_out(k, g, u) {
+      set_arc(m, u, g->out_to[k], g->out_cost[k]);
+    }
+  }
+  floyd_warshall(m, n_threads > 0 ? n_threads : 1);
+}
+
+/**
+ * Shortest distances in the subgraph induced by the n nodes, using
+ * n_threads threads. The paths only go through the given nodes, so the
+ * distances are the ones of g when, for instance, the nodes are closed
+ * under ancestors and only distances from ancestors are used.
+ */
+void apsp_subset(const struct csr_graph *g, const long *nodes, long n,
+                 struct dist_matrix *m, unsigned n_threads)
+{
+  long i, u, k, v;
+  long *idx;
+
+  init_dist_matrix(m, n);
+  m->nodes = (long *)xmalloc((n > 0 ? n : 1)*sizeof(long));
+  memcpy(m->nodes, nodes, n*sizeof(long));
+  idx = (long *)xmalloc(g->n_nodes*sizeof(long));
+  for (u = 0; u < g->n_nodes; u++) {
+    idx[u] = -1;
+  }
+  for (i = 0; i < n; i++) {
+    u = nodes[i];
+    if ((u < 0) || (u >= g->n_nodes))
+      fatal("Error, node %ld is not in the graph", u);
+    if (idx[u] != -1)
+      fatal("Error, node %ld is repeated in the subset", u);
+    idx[u] = i;
+  }
+  for (i = 0; i < n; i++) {
+    u = nodes[i];
+    csr_for_each_out(k, g, u) {
+      v = idx[g->out_to[k]];
+      if (v != -1)
+        set_arc(m, i, v, g->out_cost[k]);
+    }
+  }
+  free(idx);
+  floyd_warshall(m, n_threads > 0 ? n_threads : 1);
+}
@@ -0,0 +1,40 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief All pairs shortest paths
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___APSP_H
+#define ___APSP_H
+
+/* Side of the square tiles of the matrix */
+#define APSP_TILE  64
+
+/**
+ * Distances between n nodes, stored by rows in one buffer. The rows
+ * have ld entries, the size rounded up to a multiple of APSP_TILE.
+ * Row and column i are the node nodes[i], or the node i when nodes is
+ * NULL. Unreachable pairs have distance INT_MAX.
+ */
+struct dist_matrix {
+  long n;
+  long ld;
+  long *d;
+  long *nodes;
+};
+
+static inline long dist_matrix_get(const struct dist_matrix *m, long i, long j)
+{
+  return m->d[i*m->ld + j];
+}
+
+void free_dist_matrix(struct dist_matrix *m);
+
+void apsp_all(const struct csr_graph *g, struct dist_matrix *m, unsigned n_threads);
+
+void apsp_subset(const struct csr_graph *g, const long *nodes, long n,
+                 struct dist_matrix *m, unsigned n_threads);
+
+#endif /* ___APSP_H */
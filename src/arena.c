@@ -0,0 +1,54 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Arena of strings named by integer handles
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "arena.h"
+
+/**
+ * The arena with room for cap chars, counting the '\0' of each string
+ */
+void init_str_arena(struct str_arena *a, size_t cap)
+{
+  if (cap == 0)
+    cap = 1;
+  a->buf = (char *)xmalloc(cap);
+  a->size = 0;
+  a->cap = cap;
+}
+
+/**
+ * Copy the len chars of s to the end of the arena, and return the handle
+ * of the copy. s does not need to end with '\0'.
+ */
+long str_arena_add(struct str_arena *a, const char *s, size_t len)
+{
+  long h;
+
+  if (a->size + len + 1 > a->cap) {
+    while (a->size + len + 1 > a->cap)
+      a->cap *= 2;
+    a->buf = (char *)xrealloc(a->buf, a->cap);
+  }
+  h = a->size;
+  memcpy(a->buf + h, s, len);
+  a->buf[h + len] = '\0';
+  a->size += len + 1;
+  return h;
+}
+
+void free_str_arena(struct str_arena *a)
+{
+  free(a->buf);
+  a->buf = NULL;
+  a->size = 0;
+  a->cap = 0;
+}
@@ -0,0 +1,38 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Arena of strings named by integer handles
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___ARENA_H
+#define ___ARENA_H
+
+#include <stddef.h>
+
+/**
+ * Strings stored one after the other in one buffer, each ended with
+ * '\0'. A string is named by its handle, the offset of its first char,
+ * which stays valid when the buffer grows. The pointers given by
+ * str_arena_get are valid only while no string is added beyond the
+ * capacity of the arena.
+ */
+struct str_arena {
+  char *buf;
+  size_t size;
+  size_t cap;
+};
+
+void init_str_arena(struct str_arena *a, size_t cap);
+
+long str_arena_add(struct str_arena *a, const char *s, size_t len);
+
+void free_str_arena(struct str_arena *a);
+
+static inline const char *str_arena_get(const struct str_arena *a, long h)
+{
+  return a->buf + h;
+}
+
+#endif /* ___ARENA_H */
@@ -0,0 +1,260 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Offline LCA of the pairs of annotations
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "CA.h"
+#include "metric.h"
+#include "batch.h"
+
+struct order_key {
+  long depth;
+  long node;
+};
+
+static int order_cmp(const void *a, const void *b)
+{
+  const struct order_key *ka = (const struct order_key *)a;
+  const struct order_key *kb = (const struct order_key *)b;
+
+  if (ka->depth != kb->depth)
+    return (ka->depth < kb->depth) - (ka->depth > kb->depth);
+  return (ka->node > kb->node) - (ka->node < kb->node);
+}
+
+/**
+ * Transpose the lists of ancestors of the annotations of v, which are
+ * taken from the cache of the metrics.
+ */
+void build_batch_lca(struct batch_lca *bl, const VEC(long) *v, const long *depth,
+                     long n_nodes)
+{
+  long a, i, u, m;
+  long *cnt, *pos;
+  const struct ancestors *anc;
+  struct order_key *keys;
+
+  bl->k = VEC_SIZE(*v);
+  cnt = (long *)xcalloc(n_nodes, sizeof(long));
+  for (a = 0; a < bl->k; a++) {
+    anc = metric_ancestors(VEC_GET(*v, a));
+    for (i = 0; i < (long)VEC_SIZE(anc->node); i++) {
+      cnt[VEC_GET(anc->node, i)]++;
+    }
+  }
+  keys = (struct order_key *)xmalloc((n_nodes + 1)*sizeof(struct order_key));
+  bl->n_order = 0;
+  for (u = 0; u < n_nodes; u++) {
+    if (cnt[u] > 0) {
+      keys[bl->n_order].depth = depth[u];
+      keys[bl->n_order].node = u;
+      bl->n_order++;
+    }
+  }
+  qsort(keys, bl->n_order, sizeof(struct order_key), order_cmp);
+
+  bl->order = (long *)xmalloc((bl->n_order + 1)*sizeof(long));
+  bl->offset = (long *)xmalloc((bl->n_order + 1)*sizeof(long));
+  pos = (long *)xmalloc(n_nodes*sizeof(long));
+  bl->offset[0] = 0;
+  for (i = 0; i < bl->n_order; i++) {
+    u = keys[i].node;
+    bl->order[i] = u;
+    bl->offset[i+1] = bl->offset[i] + cnt[u];
+    pos[u] = bl->offset[i];
+  }
+  free(keys);
+  m = bl->offset[bl->n_order];
+  bl->ann = (long *)xmalloc((m + 1)*sizeof(long));
+  bl->dist = (long *)xmalloc((m + 1)*sizeof(long));
+  for (a = 0; a < bl->k; a++) {
+    anc = metric_ancestors(VEC_GET(*v, a));
+    for (i = 0; i < (long)VEC_SIZE(anc->node); i++) {
+      u = VEC_GET(anc->node, i);
+      bl->ann[pos[u]] = a;
+      bl->dist[pos[u]] = VEC_GET(anc->dist, i);
+      pos[u]++;
+    }
+  }
+  free(pos);
+  free(cnt);
+  DEBUG("\n** Batch LCA with %ld nodes and %ld entries done ** \n", bl->n_order, m);
+}
+
+/**
+ * First entry of [s, e) with annotation index at least a
+ */
+static inline long lower_entry(const long *ann, long s, long e, long a)
+{
+  long mid;
+
+  while (s < e) {
+    mid = s + (e - s)/2;
+    if (ann[mid] < a)
+      s = mid + 1;
+    else
+      e = mid;
+  }
+  return s;
+}
+
+void init_batch_lca_ws(struct batch_lca_ws *ws, const struct batch_lca *bl)
+{
+  long n_words;
+
+  n_words = (bl->k + 63)/64;
+  ws->max_rows = 0;
+  ws->max_count = 0;
+  ws->base = NULL;
+  ws->open = NULL;
+  ws->dv = (uint64_t *)xcalloc(n_words + 1, sizeof(uint64_t));
+  ws->dval = (long *)xmalloc((bl->k + 1)*sizeof(long));
+  ws->lca = NULL;
+  ws->dax = NULL;
+  ws->day = NULL;
+}
+
+void free_batch_lca_ws(struct batch_lca_ws *ws)
+{
+  free(ws->base);
+  free(ws->open);
+  free(ws->dv);
+  free(ws->dval);
+  free(ws->lca);
+  free(ws->dax);
+  free(ws->day);
+  ws->max_rows = 0;
+  ws->max_count = 0;
+}
+
+/**
+ * Room in ws for n_rows rows of n_words words and count results. The
+ * bits of open are all clear between two calls of batch_lca_range.
+ */
+static void reserve_batch_lca_ws(struct batch_lca_ws *ws, long n_rows, long n_words,
+                                 long count)
+{
+  if (n_rows > ws->max_rows) {
+    free(ws->base);
+    free(ws->open);
+    ws->max_rows = n_rows;
+    ws->base = (long *)xmalloc(n_rows*sizeof(long));
+    ws->open = (uint64_t *)xcalloc(n_rows*n_words, sizeof(uint64_t));
+  }
+  if (count > ws->max_count) {
+    ws->max_count = count;
+    ws->lca = (long *)xrealloc(ws->lca, count*sizeof(long));
+    ws->dax = (long *)xrealloc(ws->dax, count*sizeof(long));
+    ws->day = (long *)xrealloc(ws->day, count*sizeof(long));
+  }
+}
+
+/**
+ * LCA of count pairs of annotations, starting at the pair (i, j) and
+ * following the rows of the upper triangle, with the distances from it
+ * to both annotations. The results are in ws->lca, ws->dax and ws->day.
+ * Each row keeps the bits of the pairs still open. The nodes are taken
+ * from the deepest one, and a node closes the open pairs of its rows
+ * whose other annotation is also below it, so a pair is closed by its
+ * deepest common ancestor with the smallest id.
+ *
+ * Each call visits the entries of a node from the first row of the
+ * range, and a node without entries in the rows is skipped after a
+ * binary search. So a range of many rows costs about one pass over the
+ * entries, and splitting the pairs in t ranges costs about t passes.
+ */
+void batch_lca_range(const struct batch_lca *bl, struct batch_lca_ws *ws,
+                     long i, long j, long count)
+{
+  long k, r, c, cs, len, left, n_rows, n_words, w, p, q, s, e, a, v, idx;
+  long *base, *dval;
+  uint64_t *open, *dv, *row, m;
+
+  k = bl->k;
+  n_words = (k + 63)/64;
+  n_rows = 0;
+  left = count;
+  for (r = i; left > 0; r++) {
+    n_rows++;
+    left -= MIN(k - ((r == i) ? j : r), left);
+  }
+  reserve_batch_lca_ws(ws, n_rows, n_words, count);
+  base = ws->base;
+  open = ws->open;
+  left = count;
+  for (r = i; r < i + n_rows; r++) {
+    cs = (r == i) ? j : r;
+    len = MIN(k - cs, left);
+    base[r - i] = count - left - cs;
+    row = open + (r - i)*n_words;
+    for (c = cs; c < cs + len; c++) {
+      row[c/64] |= UINT64_C(1) << (c%64);
+    }
+    left -= len;
+  }
+
+  dv = ws->dv;
+  dval = ws->dval;
+  left = count;
+  for (p = 0; (p < bl->n_order) && (left > 0); p++) {
+    s = bl->offset[p];
+    e = bl->offset[p+1];
+    q = lower_entry(bl->ann, s, e, i);
+    if ((q == e) || (bl->ann[q] >= i + n_rows))
+      continue;
+    v = bl->order[p];
+    /* The pairs of the rows from i only have annotations from i */
+    for (a = q; a < e; a++) {
+      dv[bl->ann[a]/64] |= UINT64_C(1) << (bl->ann[a]%64);
+      dval[bl->ann[a]] = bl->dist[a];
+    }
+    for (s = q; (q < e) && (bl->ann[q] < i + n_rows); q++) {
+      r = bl->ann[q];
+      row = open + (r - i)*n_words;
+      for (w = r/64; w < n_words; w++) {
+        m = row[w] & dv[w];
+        if (!m)
+          continue;
+        row[w] &= ~m;
+        while (m) {
+          c = w*64 + __builtin_ctzll(m);
+          m &= m - 1;
+          idx = base[r - i] + c;
+          ws->lca[idx] = v;
+          ws->dax[idx] = dval[r];
+          ws->day[idx] = dval[c];
+          left--;
+        }
+      }
+    }
+    for (a = s; a < e; a++) {
+      dv[bl->ann[a]/64] = 0;
+    }
+  }
+  if (left > 0)
+    fatal("Error with the lowest common ancestor");
+}
+
+void free_batch_lca(struct batch_lca *bl)
+{
+  free(bl->order);
+  free(bl->offset);
+  free(bl->ann);
+  free(bl->dist);
+  bl->k = 0;
+  bl->n_order = 0;
+}
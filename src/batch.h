@@ -0,0 +1,56 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Offline LCA of the pairs of annotations
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___BATCH_H
+#define ___BATCH_H
+
+/**
+ * The ancestors of the k annotations, by decreasing depth and then by
+ * increasing id. The entries [offset[i], offset[i+1]) of order[i] are
+ * the indexes of the annotations below it, in increasing order, with
+ * the distances from order[i] to them.
+ */
+struct batch_lca {
+  long k;
+  long n_order;
+  long *order;
+  long *offset;
+  long *ann;
+  long *dist;
+};
+
+/**
+ * Buffers of batch_lca_range, owned by one thread. They grow to the
+ * largest range seen, and are reused by the next calls. lca, dax and
+ * day hold the results of the last range.
+ */
+struct batch_lca_ws {
+  long max_rows;
+  long max_count;
+  long *base;
+  uint64_t *open;
+  uint64_t *dv;
+  long *dval;
+  long *lca;
+  long *dax;
+  long *day;
+};
+
+void build_batch_lca(struct batch_lca *bl, const VEC(long) *v, const long *depth,
+                     long n_nodes);
+
+void init_batch_lca_ws(struct batch_lca_ws *ws, const struct batch_lca *bl);
+
+void free_batch_lca_ws(struct batch_lca_ws *ws);
+
+void batch_lca_range(const struct batch_lca *bl, struct batch_lca_ws *ws,
+                     long i, long j, long count);
+
+void free_batch_lca(struct batch_lca *bl);
+
+#endif /* ___BATCH_H */
@@ -0,0 +1,217 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Transitive closure of the annotations as bit rows
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "CA.h"
+#include "closure.h"
+
+#ifdef SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+/* The rows are padded to blocks of four words */
+#define WORDS_BLOCK  4
+
+struct column {
+     long depth;
+     long node;
+};
+
+static int column_cmp(const void *a, const void *b)
+{
+     const struct column *ca = (const struct column *)a;
+     const struct column *cb = (const struct column *)b;
+
+     if (ca->depth != cb->depth)
+	  return (ca->depth > cb->depth) - (ca->depth < cb->depth);
+     return (ca->node < cb->node) - (ca->node > cb->node);
+}
+
+static inline long words_of(long n_cols)
+{
+     long w;
+
+     w = (n_cols + 63)/64;
+     return ((w + WORDS_BLOCK - 1)/WORDS_BLOCK)*WORDS_BLOCK;
+}
+
+/**
+ * Build the rows of the distinct terms. anc[t] must be the ancestors
+ * of each term t.
+ */
+void build_closure(struct closure *tc, struct ancestors **anc,
+		   const long *terms, long n_terms, const long *depth, long n_nodes)
+{
+     long i, j, t, v, c;
+     long *col;
+     uint64_t *r;
+     VEC(long) nodes;
+     struct column *cols;
+
+     tc->row = (long *)xmalloc(n_nodes*sizeof(long));
+     col = (long *)xmalloc(n_nodes*sizeof(long));
+     for (i = 0; i < n_nodes; i++) {
+	  tc->row[i] = -1;
+	  col[i] = -1;
+     }
+     VEC_INIT(long, nodes);
+     tc->n_rows = 0;
+     for (i = 0; i < n_terms; i++) {
+	  t = terms[i];
+	  if (tc->row[t] != -1)
+	       continue;
+	  tc->row[t] = tc->n_rows++;
+	  for (j = 0; j < (long)VEC_SIZE(anc[t]->node); j++) {
+	       v = VEC_GET(anc[t]->node, j);
+	       if (col[v] == -1) {
+		    col[v] = 0;
+		    VEC_PUSH(long, nodes, v);
+	       }
+	  }
+     }
+
+     tc->n_cols = VEC_SIZE(nodes);
+     cols = (struct column *)xmalloc((tc->n_cols + 1)*sizeof(struct column));
+     for (c = 0; c < tc->n_cols; c++) {
+	  cols[c].node = VEC_GET(nodes, c);
+	  cols[c].depth = depth[cols[c].node];
+     }
+     qsort(cols, tc->n_cols, sizeof(struct column), column_cmp);
+     tc->col_node = (long *)xmalloc((tc->n_cols + 1)*sizeof(long));
+     for (c = 0; c < tc->n_cols; c++) {
+	  tc->col_node[c] = cols[c].node;
+	  col[cols[c].node] = c;
+     }
+     free(cols);
+     VEC_DESTROY(nodes);
+
+     tc->n_words = words_of(tc->n_cols);
+     tc->bits = (uint64_t *)xcalloc(tc->n_rows*tc->n_words + 1, sizeof(uint64_t));
+     for (i = 0; i < n_terms; i++) {
+	  t = terms[i];
+	  r = tc->bits + tc->row[t]*tc->n_words;
+	  for (j = 0; j < (long)VEC_SIZE(anc[t]->node); j++) {
+	       c = col[VEC_GET(anc[t]->node, j)];
+	       r[c/64] |= UINT64_C(1) << (c%64);
+	  }
+     }
+     free(col);
+}
+
+/**
+ * Highest column set in both rows, -1 if there is none
+ */
+static long highest_common_scalar(const uint64_t *rx, const uint64_t *ry, long n_words)
+{
+     long w;
+     uint64_t b;
+
+     for (w = n_words - 1; w >= 0; w--) {
+	  b = rx[w] & ry[w];
+	  if (b)
+	       return w*64 + 63 - __builtin_clzll(b);
+     }
+     return -1;
+}
+
+#ifdef SIMD_DISPATCH
+
+/**
+ * highest_common_scalar that skips the blocks of four words without
+ * common bits
+ */
+TARGET("avx2")
+static long highest_common_avx2(const uint64_t *rx, const uint64_t *ry, long n_words)
+{
+     long w, k;
+     uint64_t b;
+     __m256i m;
+
+     for (w = n_words - WORDS_BLOCK; w >= 0; w -= WORDS_BLOCK) {
+	  m = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(rx + w)),
+			       _mm256_loadu_si256((const __m256i *)(ry + w)));
+	  if (_mm256_testz_si256(m, m))
+	       continue;
+	  for (k = WORDS_BLOCK - 1; k >= 0; k--) {
+	       b = rx[w + k] & ry[w + k];
+	       if (b)
+		    return (w + k)*64 + 63 - __builtin_clzll(b);
+	  }
+     }
+     return -1;
+}
+
+#endif
+
+static long highest_common(const uint64_t *rx, const uint64_t *ry, long n_words)
+{
+#ifdef SIMD_DISPATCH
+     if (__builtin_cpu_supports("avx2"))
+	  return highest_common_avx2(rx, ry, n_words);
+#endif
+     return highest_common_scalar(rx, ry, n_words);
+}
+
+/**
+ * The lowest common ancestor of x and y, or -1 if x or y has no row
+ */
+long closure_lca(const struct closure *tc, long x, long y)
+{
+     long c;
+
+     if ((tc->row[x] == -1) || (tc->row[y] == -1))
+	  return -1;
+     c = highest_common(tc->bits + tc->row[x]*tc->n_words,
+			tc->bits + tc->row[y]*tc->n_words, tc->n_words);
+     if (c == -1)
+	  fatal("Error with the lowest common ancestor");
+     return tc->col_node[c];
+}
+
+/**
+ * The common ancestors of x and y with the largest depth, in increasing
+ * order of id. x and y must have a row.
+ */
+void closure_lca_set(const struct closure *tc, long x, long y,
+		     const long *depth, VEC(long) *set)
+{
+     long c, max;
+     const uint64_t *rx, *ry;
+
+     assert((tc->row[x] != -1) && (tc->row[y] != -1));
+     rx = tc->bits + tc->row[x]*tc->n_words;
+     ry = tc->bits + tc->row[y]*tc->n_words;
+     c = highest_common(rx, ry, tc->n_words);
+     if (c == -1)
+	  fatal("Error with the lowest common ancestor");
+     max = depth[tc->col_node[c]];
+     VEC_CLEAR(*set);
+     for (; (c >= 0) && (depth[tc->col_node[c]] == max); c--) {
+	  if ((rx[c/64] & ry[c/64]) & (UINT64_C(1) << (c%64)))
+	       VEC_PUSH(long, *set, tc->col_node[c]);
+     }
+}
+
+void free_closure(struct closure *tc)
+{
+     free(tc->bits);
+     free(tc->col_node);
+     free(tc->row);
+     tc->n_rows = 0;
+     tc->n_cols = 0;
+}
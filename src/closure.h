@@ -0,0 +1,39 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Transitive closure of the annotations as bit rows
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___CLOSURE_H
+#define ___CLOSURE_H
+
+#include <stdint.h>
+
+/**
+ * One row of bits for each term, with the bit of each of its ancestors
+ * set. The columns are the ancestors of all the terms, sorted by depth
+ * and then by decreasing id, so the highest bit set in the AND of two
+ * rows is the lowest common ancestor returned by LCA_CA.
+ */
+struct closure {
+     long n_rows;
+     long n_cols;
+     long n_words;
+     uint64_t *bits;
+     long *col_node;
+     long *row;
+};
+
+void build_closure(struct closure *tc, struct ancestors **anc,
+		   const long *terms, long n_terms, const long *depth, long n_nodes);
+
+long closure_lca(const struct closure *tc, long x, long y);
+
+void closure_lca_set(const struct closure *tc, long x, long y,
+		     const long *depth, VEC(long) *set);
+
+void free_closure(struct closure *tc);
+
+#endif /* ___CLOSURE_H */
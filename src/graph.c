@@ -22,12 +22,19 @@
 #include "util.h"
 #include "memory.h"
 #include "graph.h"
+#include "apsp.h"
+#include "reach.h"
+#include "labels.h"
 
 #define COST        1
 #define ROOT        0
 #define INFTY       INT_MAX
 #define NS          -1
 #define ZERO        0
+
+/* 2-hop labels that answer the shortest path queries on labels_graph */
+static const struct csr_graph *labels_graph = NULL;
+static const struct hop_labels *labels = NULL;
 #define BUFSZ       256
 
 typedef enum {WHITE, GRAY, BLACK} color_e;
@@ -215,129 +222,366 @@ bool find_edge(struct graph *g, long v1, long v2)
 /******************************************************
 *******************************************************
 **
-** Graph Search Algorithms
+** Compressed Sparse Row Graph
 **
 *******************************************************
 *******************************************************/
 
-static void dfs_visit(const struct graph *g, long u, long *d,
-		      long *f, long *pred, color_e *color, long *ctr)
+/**
+ * Build the frozen representation of g. The arcs of each node keep
+ * the order of the adjacent lists of g, and the arcs that enter a node
+ * are in the order in which graph_inverse would add them.
+ */
+static void csr_alloc(struct csr_graph *cg, long n, long m)
 {
-  long v;
-  struct edge_list *etmp;
+  cg->n_nodes = n;
+  cg->n_edges = m;
+  cg->is_view = false;
+  cg->out_offset = (long *)xcalloc(n+1, sizeof(long));
+  cg->in_offset = (long *)xcalloc(n+1, sizeof(long));
+  cg->out_to = (long *)xmalloc(m*sizeof(long));
+  cg->out_cost = (long *)xmalloc(m*sizeof(long));
+  cg->out_id = (long *)xmalloc(m*sizeof(long));
+  cg->in_from = (long *)xmalloc(m*sizeof(long));
+  cg->in_cost = (long *)xmalloc(m*sizeof(long));
+  cg->in_id = (long *)xmalloc(m*sizeof(long));
+}
+
+void csr_build(struct csr_graph *cg, const struct graph *g)
+{
+  long i, n, m, u, v, pos;
+  long *next;
+  struct edge_list *tmp;
+
+  n = g->n_nodes;
+  m = g->n_edges;
+  csr_alloc(cg, n, m);
 
-  color[u] = GRAY;
-  d[u] = ++(*ctr);
-  adj_for_each(etmp, g->adj_list[u]) {
-    v = etmp->item.to;
-    if (color[v] == WHITE) {
-      pred[v] = u;
-      dfs_visit(g, v, d, f, pred, color, ctr);
+  graph_for_each(tmp, g) {
+    cg->out_offset[tmp->item.from+1]++;
+    cg->in_offset[tmp->item.to+1]++;
+  }
+  for (i = 0; i < n; i++) {
+    cg->out_offset[i+1] += cg->out_offset[i];
+    cg->in_offset[i+1] += cg->in_offset[i];
+  }
+  assert(cg->out_offset[n] == m);
+
+  next = (long *)xmalloc(n*sizeof(long));
+  memcpy(next, cg->in_offset, n*sizeof(long));
+  pos = 0;
+  graph_for_each(tmp, g) {
+    u = tmp->item.from;
+    v = tmp->item.to;
+    assert(pos < cg->out_offset[u+1]);
+    cg->out_to[pos] = v;
+    cg->out_cost[pos] = tmp->item.cost;
+    cg->out_id[pos] = tmp->item.id;
+    pos++;
+    cg->in_from[next[v]] = u;
+    cg->in_cost[next[v]] = tmp->item.cost;
+    cg->in_id[next[v]] = tmp->item.id;
+    next[v]++;
+  }
+  free(next);
+}
+
+/**
+ * Build cg from the array of the m arcs of a graph with n nodes, without
+ * the adjacency lists. The arcs are stored in the same order as
+ * csr_build stores a graph with the arcs added in the order of e.
+ */
+void csr_build_edges(struct csr_graph *cg, long n, const struct edge *e, long m)
+{
+  long i, k, u, v;
+  long *next;
+
+  csr_alloc(cg, n, m);
+  for (i = 0; i < m; i++) {
+    if ((e[i].from < 0) || (e[i].from >= n) || (e[i].to < 0) || (e[i].to >= n))
+      fatal("Error, arc %ld with a node out of the graph\n", e[i].id);
+    cg->out_offset[e[i].from+1]++;
+    cg->in_offset[e[i].to+1]++;
+  }
+  for (u = 0; u < n; u++) {
+    cg->out_offset[u+1] += cg->out_offset[u];
+    cg->in_offset[u+1] += cg->in_offset[u];
+  }
+
+  next = (long *)xmalloc((n+1)*sizeof(long));
+  memcpy(next, cg->out_offset, n*sizeof(long));
+  for (i = 0; i < m; i++) {
+    k = next[e[i].from]++;
+    cg->out_to[k] = e[i].to;
+    cg->out_cost[k] = e[i].cost;
+    cg->out_id[k] = e[i].id;
+  }
+  memcpy(next, cg->in_offset, n*sizeof(long));
+  for (u = 0; u < n; u++) {
+    csr_for_each_out(k, cg, u) {
+      v = cg->out_to[k];
+      cg->in_from[next[v]] = u;
+      cg->in_cost[next[v]] = cg->out_cost[k];
+      cg->in_id[next[v]] = cg->out_id[k];
+      next[v]++;
     }
   }
-  color[u] = BLACK;
-  f[u] = ++(*ctr);
+  free(next);
 }
 
-void dfs_search(const struct graph *g, long s, long *d, long *f, long *pred)
+/**
+ * Set rev as the graph with all the arcs of cg reversed.
+ * The arrays are shared with cg, so rev must not outlive it.
+ */
+void csr_reverse(const struct csr_graph *cg, struct csr_graph *rev)
 {
-  long i, n, ctr;
-  color_e *color;
+  rev->n_nodes = cg->n_nodes;
+  rev->n_edges = cg->n_edges;
+  rev->out_offset = cg->in_offset;
+  rev->out_to = cg->in_from;
+  rev->out_cost = cg->in_cost;
+  rev->out_id = cg->in_id;
+  rev->in_offset = cg->out_offset;
+  rev->in_from = cg->out_to;
+  rev->in_cost = cg->out_cost;
+  rev->in_id = cg->out_id;
+  rev->is_view = true;
+}
 
-  n = g->n_nodes;
-  ctr = 0;
-  color = (color_e *)xmalloc(n*sizeof(color_e));
-  for (i = 0; i < n; i++) {
-    color[i] = WHITE;
-    pred[i] = NS;
-    d[i] = NS;
-    f[i] = NS;
+void free_csr_graph(struct csr_graph *cg)
+{
+  if (!cg->is_view) {
+    free(cg->out_offset);
+    free(cg->out_to);
+    free(cg->out_cost);
+    free(cg->out_id);
+    free(cg->in_offset);
+    free(cg->in_from);
+    free(cg->in_cost);
+    free(cg->in_id);
   }
+  cg->n_nodes = 0;
+  cg->n_edges = 0;
+}
 
-  dfs_visit(g, s, d, f, pred, color, &ctr);
-  /*for (i = 0; i < n; i++) {
-    if (color[i] == WHITE) {
-    dfs_visit(g, i, d, f, pred, color, &ctr);
+void print_csr_graph(const struct csr_graph *cg)
+{
+  long i, k, cont;
+
+  printf("\n***** Graph *****\n");
+  printf("Num. of Nodes %ld --- Num. of Edges %ld\n", cg->n_nodes, cg->n_edges);
+  for (i = 0; i < cg->n_nodes; i++) {
+    printf("Node %ld - d in-out (%ld, %ld): ", i,
+           cg->in_offset[i+1] - cg->in_offset[i],
+           cg->out_offset[i+1] - cg->out_offset[i]);
+    cont = 0;
+    csr_for_each_out(k, cg, i) {
+      if (cont % 4 == 0 && cont != 0)
+        printf("\n");
+      printf("(id %ld f %ld t %ld) ", cg->out_id[k], i, cg->out_to[k]);
+      cont++;
     }
-    }*/
-  free(color);
+    printf("\n");
+  }
+}
+
+/******************************************************
+*******************************************************
+**
+** Graph Search Algorithms
+**
+*******************************************************
+*******************************************************/
+
+void init_search_ctx(struct search_ctx *sc, long n)
+{
+  sc->n_nodes = n;
+  sc->gen = 0;
+  sc->stamp = (unsigned long *)xcalloc(n, sizeof(unsigned long));
+  sc->val = (long *)xmalloc(n*sizeof(long));
+  sc->aux = (long *)xmalloc(n*sizeof(long));
+  sc->pred = (long *)xmalloc(n*sizeof(long));
+  sc->mark = (char *)xmalloc(n*sizeof(char));
+  sc->heap = (long *)xmalloc(n*sizeof(long));
+  sc->pos = (long *)xmalloc(n*sizeof(long));
+  VEC_INIT(long, sc->touched);
 }
 
-static void dfs_min(const struct graph *g, long x, long t, long *cmin, bool *visit)
+void free_search_ctx(struct search_ctx *sc)
 {
-  long y;
-  struct edge_list *etmp;
+  free(sc->stamp);
+  free(sc->val);
+  free(sc->aux);
+  free(sc->pred);
+  free(sc->mark);
+  free(sc->heap);
+  free(sc->pos);
+  VEC_DESTROY(sc->touched);
+  sc->n_nodes = 0;
+}
 
-  visit[x] = true;
-  if (x == t) {
-    cmin[x] = 0;
-  } else {
-    adj_for_each(etmp, g->adj_list[x]) {
-      y = etmp->item.to;
-      if (!visit[y]) {
-        dfs_min(g, y, t, cmin, visit);
+/**
+ * Start a new search in sc. All the entries become invalid without
+ * touching the buffers, except when the generation counter wraps.
+ */
+void search_ctx_reset(struct search_ctx *sc)
+{
+  sc->gen++;
+  if (sc->gen == 0) {
+    memset(sc->stamp, 0, sc->n_nodes*sizeof(unsigned long));
+    sc->gen = 1;
+  }
+  VEC_CLEAR(sc->touched);
+}
+
+/**
+ * Make the entry of v valid in the current search of sc,
+ * with val and pred set to NS and mark set to WHITE.
+ */
+static inline void ctx_touch(struct search_ctx *sc, long v)
+{
+  sc->stamp[v] = sc->gen;
+  sc->val[v] = NS;
+  sc->aux[v] = NS;
+  sc->pred[v] = NS;
+  sc->mark[v] = WHITE;
+  VEC_PUSH(long, sc->touched, v);
+}
+
+static inline bool ctx_seen(const struct search_ctx *sc, long v)
+{
+  return sc->stamp[v] == sc->gen;
+}
+
+/**
+ * Use sc for a new search, or tmp when sc is NULL
+ */
+static struct search_ctx *ctx_begin(const struct csr_graph *g, struct search_ctx *sc,
+                                    struct search_ctx *tmp)
+{
+  if (sc == NULL) {
+    init_search_ctx(tmp, g->n_nodes);
+    sc = tmp;
+  }
+  assert(sc->n_nodes >= g->n_nodes);
+  search_ctx_reset(sc);
+  return sc;
+}
+
+static void ctx_end(struct search_ctx *sc, struct search_ctx *tmp)
+{
+  if (sc == tmp)
+    free_search_ctx(tmp);
+}
+
+/**
+ * Depth first search from s. After the search, search_ctx_pred,
+ * search_ctx_d and search_ctx_f give the predecessor, discovery and
+ * finishing time of each node, or NS if it was not reached. The
+ * nodes reached are in sc->touched in order of discovery.
+ * The search goes back through the predecessors instead of using
+ * recursion, and the position of the next arc of a node is kept in
+ * sc->aux until the node finishes.
+ */
+void dfs_search(const struct csr_graph *g, long s, struct search_ctx *sc)
+{
+  long u, v, ctr;
+
+  assert(sc != NULL);
+  search_ctx_reset(sc);
+  ctr = 0;
+  ctx_touch(sc, s);
+  sc->mark[s] = GRAY;
+  sc->val[s] = ++ctr;
+  sc->aux[s] = g->out_offset[s];
+  u = s;
+  while (u != NS) {
+    if (sc->aux[u] < g->out_offset[u+1]) {
+      v = g->out_to[sc->aux[u]];
+      sc->aux[u]++;
+      if (!ctx_seen(sc, v)) {
+        ctx_touch(sc, v);
+        sc->pred[v] = u;
+        sc->mark[v] = GRAY;
+        sc->val[v] = ++ctr;
+        sc->aux[v] = g->out_offset[v];
+        u = v;
       }
+    } else {
+      sc->mark[u] = BLACK;
+      sc->aux[u] = ++ctr;
+      u = sc->pred[u];
     }
-    adj_for_each(etmp, g->adj_list[x]) {
-      y = etmp->item.to;
-      if ((cmin[y] != INFTY) && (cmin[x] > cmin[y] + etmp->item.cost)) {
-        cmin[x] = cmin[y] + etmp->item.cost;
+  }
+}
+
+/**
+ * Nodes reachable from s in postorder of a depth first search. The
+ * search keeps the position of the next arc of each node in sc->aux
+ * and goes back through sc->pred, so it does not use recursion.
+ */
+void dfs_postorder(const struct csr_graph *g, long s, struct search_ctx *sc,
+                   VEC(long) *order)
+{
+  long u, v;
+
+  assert(sc != NULL);
+  search_ctx_reset(sc);
+  VEC_CLEAR(*order);
+  ctx_touch(sc, s);
+  sc->aux[s] = g->out_offset[s];
+  u = s;
+  while (u != NS) {
+    if (sc->aux[u] < g->out_offset[u+1]) {
+      v = g->out_to[sc->aux[u]];
+      sc->aux[u]++;
+      if (!ctx_seen(sc, v)) {
+        ctx_touch(sc, v);
+        sc->pred[v] = u;
+        sc->aux[v] = g->out_offset[v];
+        u = v;
       }
+    } else {
+      VEC_PUSH(long, *order, u);
+      u = sc->pred[u];
     }
   }
 }
 
-long min_distance(const struct graph *g, long s, long t)
+/**
+ * Enter the node v from parent in a search that looks for the node t.
+ * The arcs of t are not explored.
+ */
+static inline void dfs_enter(const struct csr_graph *g, struct search_ctx *sc,
+                             long v, long parent, long t, long init)
 {
-  long i, n, min;
-  long *cmin;
-  bool *visit;
-
-  n = g->n_nodes;
-  assert(n > 0);
-  visit = (bool *)xmalloc(n * sizeof(bool));
-  cmin = (long *)xmalloc(n * sizeof(long));
-  memset(visit, false, n*sizeof(bool));
-  for (i = 0; i < n; i++) {
-    cmin[i] = INFTY;
+  ctx_touch(sc, v);
+  sc->pred[v] = parent;
+  if (v == t) {
+    sc->val[v] = 0;
+    sc->aux[v] = g->out_offset[v+1];
+  } else {
+    sc->val[v] = init;
+    sc->aux[v] = g->out_offset[v];
   }
-  dfs_min(g, s, t, cmin, visit);
-  min = cmin[s];
-  free(visit);
-  free(cmin);
-
-  return min;
 }
 
-void all_pairs_shortest(const struct graph *g, long **dist)
+/**
+ * Shortest distances between all the nodes, in the rows of dist.
+ * See apsp_all for the matrix in one buffer and more threads.
+ */
+void all_pairs_shortest(const struct csr_graph *g, long **dist)
 {
-  long i, j, k;
-  long long new_dist;
-  struct edge_list *etmp;
+  long i, j;
+  struct dist_matrix m;
 
+  apsp_all(g, &m, 1);
   for (i = 0; i < g->n_nodes; i++) {
     for (j = 0; j < g->n_nodes; j++) {
-      dist[i][j] = INFTY;
-    }
-    dist[i][i] = 0;
-    adj_for_each(etmp, g->adj_list[i]){
-      k = etmp->item.to;
-      dist[i][k] = etmp->item.cost;
-    }
-  }
-  for (k = 0; k < g->n_nodes; k++) {
-    for (i = 0; i < g->n_nodes; i++) {
-      if (dist[i][k] == INFTY)
-        continue;
-      for (j = 0; j < g->n_nodes; j++) {
-        new_dist = dist[i][k]; /* avoid overflow of infinity distance */
-        new_dist += dist[k][j];
-        if (new_dist < dist[i][j]) {
-          dist[i][j] = new_dist;
-        }
-      }
+      dist[i][j] = dist_matrix_get(&m, i, j);
     }
   }
+  free_dist_matrix(&m);
 }
 
 void graph_inverse(const struct graph *orig, struct graph *inv)
@@ -364,51 +608,53 @@ void graph_undirect(const struct graph *orig, struct graph *ud)
   ud->n_edges = ud->n_edges/2;
 }
 
-static void dfs_max(const struct graph *g, long x, long t, long *cmax, bool *visit)
+/**
+ * cmax of every node reached from s, in sc->val
+ */
+static void dfs_max(const struct csr_graph *g, long s, long t, struct search_ctx *sc)
 {
-  long y;
-  struct edge_list *etmp;
+  long x, y;
+  long k;
+  long *cmax;
 
-  visit[x] = true;
-  if (x == t) {
-    cmax[x] = 0;
-  } else {
-    adj_for_each(etmp, g->adj_list[x]) {
-      y = etmp->item.to;
-      if (!visit[y]) {
-        dfs_max(g, y, t, cmax, visit);
+  cmax = sc->val;
+  dfs_enter(g, sc, s, NS, t, NS);
+  x = s;
+  while (x != NS) {
+    if (sc->aux[x] < g->out_offset[x+1]) {
+      y = g->out_to[sc->aux[x]];
+      sc->aux[x]++;
+      if (!ctx_seen(sc, y)) {
+        dfs_enter(g, sc, y, x, t, NS);
+        x = y;
       }
-    }
-    adj_for_each(etmp, g->adj_list[x]) {
-      y = etmp->item.to;
-      //		printf("Entrando x %ld - y %ld\n", x, y);
-      if ((cmax[y] != NS) && (cmax[x] <= cmax[y] + etmp->item.cost)) {
-        //printf("x %ld - y %ld - cy %ld nc %ld\n", x, y, cmax[y], (cmax[x] + COST));
-        cmax[x] = cmax[y] + etmp->item.cost;
+    } else {
+      if (x != t) {
+        csr_for_each_out(k, g, x) {
+          y = g->out_to[k];
+          if ((cmax[y] != NS) && (cmax[x] <= cmax[y] + g->out_cost[k])) {
+            cmax[x] = cmax[y] + g->out_cost[k];
+          }
+        }
       }
-
+      x = sc->pred[x];
     }
-
   }
 }
 
-long max_distance(const struct graph *g, long s, long t)
+/**
+ * Length of the longest path from s to t, or NS if there is no
+ * path. sc can be NULL, then the buffers are allocated for this call.
+ */
+long max_distance(const struct csr_graph *g, long s, long t, struct search_ctx *sc)
 {
-  long i, n, max;
-  long *cmax;
-  bool *visit;
+  long max;
+  struct search_ctx tmp;
 
-  n = g->n_nodes;
-  visit = (bool *)xmalloc(n * sizeof(bool));
-  cmax = (long *)xmalloc(n * sizeof(long));
-  memset(visit, false, n*sizeof(bool));
-  for (i = 0; i < n; i++) {
-    cmax[i] = NS;
-  }
-  dfs_max(g, s, t, cmax, visit);
-  max = cmax[s];
-  free(visit);
-  free(cmax);
+  sc = ctx_begin(g, sc, &tmp);
+  dfs_max(g, s, t, sc);
+  max = sc->val[s];
+  ctx_end(sc, &tmp);
 
   return max;
 }
@@ -422,11 +668,11 @@ long max_distance(const struct graph *g, long s, long t)
 *******************************************************/
 
 /*
- * Macros used for binaries heaps implementations
+ * Macros used for the d-ary heap
  */
-#define PARENT(i)     ((long)(((i) - 1) / 2))
-#define LEFT(i)       (((i) * 2) + 1)
-#define RIGHT(i)      (((i) * 2) + 2)
+#define HEAP_D        4
+#define PARENT(i)     (((i) - 1) / HEAP_D)
+#define CHILD(i)      (((i) * HEAP_D) + 1)
 
 /*********************************
  **  Constants
@@ -438,140 +684,112 @@ long max_distance(const struct graph *g, long s, long t)
  ** Structures
  *********************************/
 
+/*
+ * Bits of the mark of a node. A node reached by the search is first
+ * OPEN and then CLOSED; GOAL is kept along with them.
+ */
 enum node_set {
-  OPEN,
-  CLOSED,
-  NONE
-};
-
-struct node_record {
-  long node;
-  long from_node;
-  struct edge *edge;
-  long cost_so_far;
-  enum node_set category;
+  NONE = 0,
+  OPEN = 1,
+  CLOSED = 2,
+  GOAL = 4
 };
 
+/*
+ * The records of the nodes live in the search context: val is the
+ * cost so far, pred the node from which it was reached, aux the arc
+ * used and mark the node set. The heap keeps the open nodes, and
+ * pos[v] is the position of the open node v in the heap. Both arrays
+ * are the ones of the search context.
+ */
 struct pqueue {
   long size;
-  struct node_record **heap;
+  long *heap;
+  long *pos;
+  const long *cost;
 };
 
 /*********************************
- ** Priority Queue (Binary Heap)
+ ** Priority Queue (d-ary Heap)
  *********************************/
 
-
-static inline void pq_init(struct pqueue *pq)
+static inline void pq_init(struct pqueue *pq, struct search_ctx *sc)
 {
   pq->size = 0;
-  pq->heap = NULL;
+  pq->heap = sc->heap;
+  pq->pos = sc->pos;
+  pq->cost = sc->val;
 }
 
-/*
-  static inline void pq_delete( struct pqueue *pq )
-  {
-  int i;
-  for( i = 0; i < pq->size; i++ )
-  free( pq->heap[i] );
-  free( pq->heap );
-  memset( pq, 0, sizeof( struct pqueue ) );
-  }
-*/
+static inline void pq_set(struct pqueue *pq, long i, long node)
+{
+  pq->heap[i] = node;
+  pq->pos[node] = i;
+}
 
-static inline void pq_insert(struct pqueue *pq, struct node_record *node)
+static void sift_up(struct pqueue *pq, long i)
 {
-  long i, p;
-  struct node_record **tmp;
+  long p, node;
 
-  tmp = xrealloc(pq->heap, (pq->size+1)*sizeof(struct node_record *));
-  pq->heap = tmp;
-  pq->heap[pq->size] = node;
-  i = pq->size;
-  p = PARENT(i);
-  while((i > 0) && ((pq->heap[i]->cost_so_far
-                     - pq->heap[p]->cost_so_far) < 0)){
-    SWAP(pq->heap[p], pq->heap[i]);
-    i = p;
+  node = pq->heap[i];
+  while (i > 0) {
     p = PARENT(i);
+    if (pq->cost[pq->heap[p]] <= pq->cost[node])
+      break;
+    pq_set(pq, i, pq->heap[p]);
+    i = p;
   }
-  pq->size++;
+  pq_set(pq, i, node);
 }
 
-static long extract_min(struct pqueue *pq, struct node_record **node)
+static void sift_down(struct pqueue *pq, long i)
 {
-  long i, j, l, r;
-  struct node_record *aux;
-  struct node_record **tmp;
-
-  if( pq->size == 0 )
-    return -1;
-  *node = pq->heap[0];
-  aux =  pq->heap[pq->size-1];
-  if( (pq->size - 1) > 0 ){
-    tmp = xrealloc(pq->heap, (pq->size-1)*sizeof(struct node_record *));
-    pq->heap = tmp;
-    pq->size--;
-  } else {
-    free(pq->heap);
-    pq->heap = NULL;
-    pq->size = 0;
-    return 0;
-  }
-  pq->heap[0] = aux;
-  i = 0;
-  l = LEFT(i);
-  r = RIGHT(i);
-  while (true) {
-    l = LEFT(i);
-    r = RIGHT(i);
-    if((l < pq->size) && ((pq->heap[i]->cost_so_far
-                           - pq->heap[l]->cost_so_far) > 0))
-      j = l;
-    else
-      j = i;
-
-    if((r < pq->size) && ((pq->heap[j]->cost_so_far
-                           - pq->heap[r]->cost_so_far) > 0))
-      j = r;
-
-    if( j == i ) {
-      break;
-    } else {
-      SWAP(pq->heap[j], pq->heap[i]);
-      i = j;
+  long c, j, end, node;
+
+  node = pq->heap[i];
+  while ((c = CHILD(i)) < pq->size) {
+    end = MIN(c + HEAP_D, pq->size);
+    for (j = c + 1; j < end; j++) {
+      if (pq->cost[pq->heap[j]] < pq->cost[pq->heap[c]])
+        c = j;
     }
+    if (pq->cost[node] <= pq->cost[pq->heap[c]])
+      break;
+    pq_set(pq, i, pq->heap[c]);
+    i = c;
   }
-  return 0;
+  pq_set(pq, i, node);
 }
 
-static long decrease_key(struct pqueue *pq, long node, long new_cost)
+static inline void pq_insert(struct pqueue *pq, long node)
 {
-  long i, p, pos;
-
-  if( pq->size == 0 )
-    return -1;
-  pos = -1;
-  for( i = 0; i < pq->size; i++ )
-    if( pq->heap[i]->node == node )
-      pos = i;
-  if( pos == - 1 )
-    return -1;
+  pq->heap[pq->size] = node;
+  pq->size++;
+  sift_up(pq, pq->size - 1);
+}
 
-  if( new_cost > pq->heap[pos]->cost_so_far )
+static long extract_min(struct pqueue *pq, long *node)
+{
+  if (pq->size == 0)
     return -1;
-  pq->heap[pos]->cost_so_far = new_cost;
-  i = pos;
-  p = PARENT(i);
-  while((i > 0) && ((pq->heap[i]->cost_so_far
-                     - pq->heap[p]->cost_so_far) < 0)){
-    SWAP(pq->heap[p], pq->heap[i]);
-    i = p;
-    p = PARENT(i);
+  *node = pq->heap[0];
+  pq->size--;
+  if (pq->size > 0) {
+    pq->heap[0] = pq->heap[pq->size];
+    sift_down(pq, 0);
   }
   return 0;
 }
 
+/**
+ * Restore the heap after the cost of node was decreased
+ */
+static inline void decrease_key(struct pqueue *pq, long node)
+{
+  assert(pq->heap[pq->pos[node]] == node);
+  sift_up(pq, pq->pos[node]);
+}
+
 struct edge *new_arc(int id, long from, long to, long c)
 {
   struct edge *e;
@@ -584,107 +802,195 @@ struct edge *new_arc(int id, long from, long to, long c)
 
   return e;
 }
-/*
-  static void copy_arc(const struct edge *from, struct edge *to)
-  {
-  to->id = from->id;
-  to->from = from->from;
-  to->to = from->to;
-  to->cost = from->cost;
-  }
-*/
+
 /*********************************
  ** Dijkstra Algorithm
  *********************************/
 
 /**
- * Dijkstra edge path with duplicate edges
+ * Shortest distances from start to the n_goals nodes of goals, in dist.
+ * The distance of a goal not reachable from start is INFTY. The search
+ * stops when all the goals are closed. sc can be NULL, then the buffers
+ * are allocated for this call.
  */
-long min_path(const struct graph *g, long start, long goal)
+void min_paths(const struct csr_graph *g, long start, const long *goals, long n_goals,
+               long *dist, struct search_ctx *sc)
 {
-  long min_dist;
-  struct node_record *start_r, *current, *end_node_r;
-  struct node_record **statusT;
+  long i, left;
+  long current;
   struct pqueue open;
-  enum node_set contains;
-  long result, end_node, end_node_cost;
-  struct edge_list *connections;
-  struct edge *etmp;
-  long i;
-
-  min_dist = 0;
-  etmp = new_arc(ARC_ID, start, start, 0);
-
-  /* Se inicializa el nodo inicial */
-  start_r = xmalloc(sizeof(struct node_record));
-  start_r->node  = start;
-  start_r->from_node = 0;
-  start_r->edge = etmp;
-  start_r->cost_so_far = 0;
-  start_r->category = OPEN;
-
-  statusT = xcalloc(g->n_nodes, sizeof(struct node_record *));
-  statusT[start_r->node] =  start_r;
-  pq_init(&open);
-  pq_insert(&open, start_r);
-  current = NULL;
-  end_node_r = NULL;
-
-  while ( open.size > 0 ) {
-    result = extract_min(&open, &current);
-    assert(result != -1);
-    if (current->node == goal)
-      break;
-    adj_for_each(connections, g->adj_list[current->node]) {
-      end_node = connections->item.to;
-      end_node_cost = current->cost_so_far + connections->item.cost;
-      if (statusT[end_node] == NULL) {
-        contains = NONE;
-      } else {
-        end_node_r = statusT[end_node];
-        contains = end_node_r->category;
-      }
-
-      if (contains == CLOSED) {
+  struct search_ctx tmp;
+  long end_node, end_node_cost;
+  long k;
+
+  sc = ctx_begin(g, sc, &tmp);
+  left = 0;
+  for (i = 0; i < n_goals; i++) {
+    if (!ctx_seen(sc, goals[i])) {
+      ctx_touch(sc, goals[i]);
+      sc->mark[goals[i]] = GOAL;
+      left++;
+    }
+  }
+  if (!ctx_seen(sc, start))
+    ctx_touch(sc, start);
+  sc->val[start] = 0;
+  sc->aux[start] = ARC_ID;
+  sc->mark[start] |= OPEN;
+  pq_init(&open, sc);
+  pq_insert(&open, start);
+
+  while ((left > 0) && (extract_min(&open, &current) != -1)) {
+    sc->mark[current] ^= OPEN | CLOSED;
+    if (sc->mark[current] & GOAL)
+      left--;
+    csr_for_each_out(k, g, current) {
+      end_node = g->out_to[k];
+      end_node_cost = sc->val[current] + g->out_cost[k];
+      if (!ctx_seen(sc, end_node)) {
+        ctx_touch(sc, end_node);
+      } else if (sc->mark[end_node] & CLOSED) {
         continue;
-      } else if (contains == OPEN) {
-        if (end_node_r->cost_so_far <= end_node_cost)
+      } else if (sc->mark[end_node] & OPEN) {
+        if (sc->val[end_node] <= end_node_cost)
           continue;
-        end_node_r->node = end_node;
-        end_node_r->from_node = current->node;
-        end_node_r->edge = &connections->item;
-        end_node_r->cost_so_far = end_node_cost;
-        result = decrease_key(&open, end_node_r->node, end_node_r->cost_so_far);
-        assert(result != -1);
-      } else {
-        end_node_r = xmalloc(sizeof(struct node_record));
-        end_node_r->node = end_node;
-        end_node_r->from_node = current->node;
-        end_node_r->edge = &connections->item;
-        end_node_r->cost_so_far = end_node_cost;
-        end_node_r->category = OPEN;
-        pq_insert(&open, end_node_r);
-        statusT[end_node_r->node] = end_node_r;
+        sc->pred[end_node] = current;
+        sc->aux[end_node] = k;
+        sc->val[end_node] = end_node_cost;
+        decrease_key(&open, end_node);
+        continue;
       }
+      sc->pred[end_node] = current;
+      sc->aux[end_node] = k;
+      sc->val[end_node] = end_node_cost;
+      sc->mark[end_node] |= OPEN;
+      pq_insert(&open, end_node);
     }
-    current->category = CLOSED;
   }
-  if (current->node != goal) {
-    min_dist = error("Error no se llego al nodo meta. Nodo alcanzado: %u\n", current->node);
-  } else {
-    min_dist = current->cost_so_far;
+  for (i = 0; i < n_goals; i++) {
+    dist[i] = (sc->mark[goals[i]] & CLOSED) ? sc->val[goals[i]] : INFTY;
   }
-  free(etmp);
+  ctx_end(sc, &tmp);
+}
 
-  for (i = 0; i < g->n_nodes; i++)
-    if (statusT[i] != NULL)
-      free(statusT[i]);
-  free(statusT);
-  free(open.heap);
+/**
+ * Dijkstra edge path with duplicate edges. sc can be NULL, then
+ * the buffers are allocated for this call.
+ */
+long min_path(const struct csr_graph *g, long start, long goal, struct search_ctx *sc)
+{
+  long min_dist;
+
+  if (g == labels_graph)
+    min_dist = hop_distance(labels, start, goal);
+  else
+    min_paths(g, start, &goal, 1, &min_dist, sc);
+  if (min_dist == INFTY)
+    min_dist = error("Error no se llego al nodo meta %ld desde %ld\n", goal, start);
 
   return  min_dist;
 }
 
+/**
+ * Dijkstra from t over the arcs that enter the nodes, which stops when
+ * s is closed. Only the ancestors of t nearer than s are visited, and
+ * with ri only the ones that are also reachable from s, so a search
+ * from a deep node to an ancestor does not depend on the size of the
+ * graph below the ancestor.
+ */
+static long upward_min(const struct csr_graph *g, long s, long t,
+                       const struct reach_index *ri, struct search_ctx *sc)
+{
+  long current, v, c;
+  long k;
+  struct pqueue open;
+
+  ctx_touch(sc, t);
+  sc->val[t] = 0;
+  sc->mark[t] = OPEN;
+  pq_init(&open, sc);
+  pq_insert(&open, t);
+  while (extract_min(&open, &current) != -1) {
+    sc->mark[current] ^= OPEN | CLOSED;
+    if (current == s)
+      return sc->val[s];
+    csr_for_each_in(k, g, current) {
+      v = g->in_from[k];
+      c = sc->val[current] + g->in_cost[k];
+      if (!ctx_seen(sc, v)) {
+        ctx_touch(sc, v);
+        if (ri && !is_ancestor(ri, s, v)) {
+          sc->mark[v] = CLOSED;
+          continue;
+        }
+        sc->pred[v] = current;
+        sc->aux[v] = k;
+        sc->val[v] = c;
+        sc->mark[v] = OPEN;
+        pq_insert(&open, v);
+      } else if ((sc->mark[v] & OPEN) && (c < sc->val[v])) {
+        sc->pred[v] = current;
+        sc->aux[v] = k;
+        sc->val[v] = c;
+        decrease_key(&open, v);
+      }
+    }
+  }
+  return INFTY;
+}
+
+/**
+ * Answer min_distance, min_distance_reach and min_path on g with the
+ * 2-hop labels hl of g, until it is called again. NULL stops using them.
+ * It must not be called while other threads query g.
+ */
+void set_distance_labels(const struct csr_graph *g, const struct hop_labels *hl)
+{
+  labels_graph = g;
+  labels = hl;
+}
+
+/**
+ * Length of the shortest path from s to t, or INFTY if there is no
+ * path. sc can be NULL, then the buffers are allocated for this call.
+ * The labels of set_distance_labels answer without a search.
+ */
+long min_distance(const struct csr_graph *g, long s, long t, struct search_ctx *sc)
+{
+  long min;
+  struct search_ctx tmp;
+
+  assert(g->n_nodes > 0);
+  if (g == labels_graph)
+    return hop_distance(labels, s, t);
+  sc = ctx_begin(g, sc, &tmp);
+  min = upward_min(g, s, t, NULL, sc);
+  ctx_end(sc, &tmp);
+
+  return min;
+}
+
+/**
+ * min_distance that only visits the nodes between s and t, as given by
+ * the index ri of g
+ */
+long min_distance_reach(const struct csr_graph *g, long s, long t,
+                        const struct reach_index *ri, struct search_ctx *sc)
+{
+  long min;
+  struct search_ctx tmp;
+
+  if (!is_ancestor(ri, s, t))
+    return INFTY;
+  if (g == labels_graph)
+    return hop_distance(labels, s, t);
+  sc = ctx_begin(g, sc, &tmp);
+  min = upward_min(g, s, t, ri, sc);
+  ctx_end(sc, &tmp);
+
+  return min;
+}
+
 /******************************************************
 *******************************************************
 **
@@ -693,96 +999,102 @@ long min_path(const struct graph *g, long start, long goal)
 *******************************************************
 *******************************************************/
 
-static void dfs_topological_sort(const struct graph *g, long u,
-				 color_e *color, struct long_list *tpl_sort)
+struct long_list *topological_sort(const struct csr_graph *g, long s)
 {
-  long v;
-  struct edge_list *etmp;
-  struct long_list *ntmp;
-
-  color[u] = GRAY;
-  adj_for_each(etmp, g->adj_list[u]) {
-    v = etmp->item.to;
-    if (color[v] == WHITE) {
-      dfs_topological_sort(g, v, color, tpl_sort);
-    }
-  }
-  color[u] = BLACK;
-  ntmp = (struct long_list *)xmalloc(sizeof(struct long_list));
-  ntmp->item = u;
-  list_add(&(ntmp->list), &(tpl_sort->list));
-}
-
-struct long_list *topological_sort(const struct graph *g, long s)
-{
-  long i, n;
-  color_e *color;
+  long u, v;
+  struct search_ctx sc;
   struct long_list *tpl_sort;
+  struct long_list *ntmp;
 
-  n = g->n_nodes;
-  color = (color_e *)xmalloc(n*sizeof(color_e));
+  init_search_ctx(&sc, g->n_nodes);
+  search_ctx_reset(&sc);
   tpl_sort = (struct long_list *)xmalloc(sizeof(struct long_list));
   INIT_LIST_HEAD(&(tpl_sort->list));
-  for (i = 0; i < n; i++) {
-    color[i] = WHITE;
-  }
-  dfs_topological_sort(g, s, color, tpl_sort);
-  /*for (i = 0; i < n; i++) {
-    if (color[i] == WHITE) {
-    dfs_visit(g, i, d, f, pred, color, &ctr);
+  ctx_touch(&sc, s);
+  sc.aux[s] = g->out_offset[s];
+  u = s;
+  while (u != NS) {
+    if (sc.aux[u] < g->out_offset[u+1]) {
+      v = g->out_to[sc.aux[u]];
+      sc.aux[u]++;
+      if (!ctx_seen(&sc, v)) {
+        ctx_touch(&sc, v);
+        sc.pred[v] = u;
+        sc.aux[v] = g->out_offset[v];
+        u = v;
+      }
+    } else {
+      ntmp = (struct long_list *)xmalloc(sizeof(struct long_list));
+      ntmp->item = u;
+      list_add(&(ntmp->list), &(tpl_sort->list));
+      u = sc.pred[u];
     }
-    }*/
-
-  free(color);
+  }
+  free_search_ctx(&sc);
 
   return tpl_sort;
 }
 
-long *calculate_depth(const struct graph *g)
+/**
+ * Longest and shortest distance from ROOT to every node, computed
+ * with a single pass over the nodes in topological order. The nodes
+ * that are not reachable from ROOT get ZERO in dmax and INFTY in dmin.
+ */
+void calculate_root_distances(const struct csr_graph *g, long *dmin, long *dmax)
 {
-  long i, nodes, m, u, v;
-  long *depth;
+  long i, nodes, u, v, c;
   struct long_list *tpl_sort;
   struct long_list *tmp;
   struct list_head *pos, *q;
-  struct edge_list *etmp;
+  long k;
 
-  m = 0;
   nodes = g->n_nodes;
-  depth = (long *)xmalloc(nodes*sizeof(long));
   tpl_sort = topological_sort(g, ROOT);
 
   for (i = 0; i < nodes; i++) {
-    depth[i] = ZERO;
+    dmax[i] = ZERO;
+    dmin[i] = INFTY;
   }
-  depth[ROOT] = ZERO;
+  dmax[ROOT] = ZERO;
+  dmin[ROOT] = ZERO;
   list_for_each_entry(tmp, &(tpl_sort->list), list) {
     u = tmp->item;
-    adj_for_each(etmp, g->adj_list[u]) {
-      v = etmp->item.to;
-      if (depth[v] < (depth[u] + etmp->item.cost))
-        depth[v] = depth[u] + etmp->item.cost;
+    csr_for_each_out(k, g, u) {
+      v = g->out_to[k];
+      c = g->out_cost[k];
+      if (dmax[v] < (dmax[u] + c))
+        dmax[v] = dmax[u] + c;
+      if (dmin[v] > (dmin[u] + c))
+        dmin[v] = dmin[u] + c;
     }
   }
   list_for_each_safe(pos, q, &(tpl_sort->list)){
     tmp = list_entry(pos, struct long_list, list);
     list_del(pos);
     free(tmp);
-    m++;
   }
-  assert(m = nodes);
   free(tpl_sort);
+}
+
+long *calculate_depth(const struct csr_graph *g)
+{
+  long *depth, *dmin;
+
+  depth = (long *)xmalloc(g->n_nodes*sizeof(long));
+  dmin = (long *)xmalloc(g->n_nodes*sizeof(long));
+  calculate_root_distances(g, dmin, depth);
+  free(dmin);
   return depth;
 }
 
-long *calculate_depth_bfs(const struct graph *g)
+long *calculate_depth_bfs(const struct csr_graph *g)
 {
   long i, n, u, v;
   color_e *color;
   long *depth;
   struct long_list queue;
   struct long_list  *ntmp;
-  struct edge_list *etmp;
+  long k;
   struct list_head *pos;
 
   n = g->n_nodes;
@@ -803,8 +1115,8 @@ long *calculate_depth_bfs(const struct graph *g)
     u = ntmp->item;
     list_del(pos);
     free(ntmp);
-    adj_for_each(etmp, g->adj_list[u]) {
-      v = etmp->item.to;
+    csr_for_each_out(k, g, u) {
+      v = g->out_to[k];
       if (color[v] == WHITE) {
         depth[v] = depth[u] + 1;
         color[v] = GRAY;
@@ -825,61 +1137,77 @@ long *calculate_depth_bfs(const struct graph *g)
   return depth;
 }
 
-static bool visit(const struct graph *g, color_e *color, long v)
+static bool visit(const struct csr_graph *g, struct search_ctx *sc, long s)
 {
-  long u;
-  struct edge_list *etmp;
-
-  color[v] = GRAY;
-  adj_for_each(etmp, g->adj_list[v]) {
-    u = etmp->item.to;
-    if (color[u] == GRAY) {
-      return true;
-    } else {
-      if (color[u] == WHITE) {
-        if (visit(g, color, u)) {
-          return true;
-        }
+  long u, v;
+
+  ctx_touch(sc, s);
+  sc->mark[s] = GRAY;
+  sc->aux[s] = g->out_offset[s];
+  u = s;
+  while (u != NS) {
+    if (sc->aux[u] < g->out_offset[u+1]) {
+      v = g->out_to[sc->aux[u]];
+      sc->aux[u]++;
+      if (!ctx_seen(sc, v)) {
+        ctx_touch(sc, v);
+        sc->mark[v] = GRAY;
+        sc->pred[v] = u;
+        sc->aux[v] = g->out_offset[v];
+        u = v;
+      } else if (sc->mark[v] == GRAY) {
+        return true;
       }
+    } else {
+      sc->mark[u] = BLACK;
+      u = sc->pred[u];
     }
   }
-  color[v] = BLACK;
   return false;
 }
 
-bool detect_cycle(const struct graph *g)
+bool detect_cycle(const struct csr_graph *g)
 {
   long i, n;
-  color_e *color;
+  bool cycle;
+  struct search_ctx sc;
 
   n = g->n_nodes;
-  color = (color_e *)xmalloc(n*sizeof(color_e));
-
-  for (i = 0; i < n; i++) {
-    color[i] = WHITE;
-  }
-  for (i = ROOT; i < n; i++) {
-    if (color[i] == WHITE) {
-      if (visit(g, color, i)) {
-        return true;
-      }
+  init_search_ctx(&sc, n);
+  search_ctx_reset(&sc);
+  cycle = false;
+  for (i = ROOT; (i < n) && !cycle; i++) {
+    if (!ctx_seen(&sc, i)) {
+      cycle = visit(g, &sc, i);
     }
   }
-  return false;
+  free_search_ctx(&sc);
+  return cycle;
 }
 
-static void dfs_spanning_tree(const struct graph *g, color_e *color, long v, bool *st)
+static void dfs_spanning_tree(const struct csr_graph *g, struct search_ctx *sc,
+                              long s, bool *st)
 {
-  long u;
-  struct edge_list *etmp;
-
-  color[v] = BLACK;
-  adj_for_each(etmp, g->adj_list[v]) {
-    u = etmp->item.to;
-    if (color[u] == WHITE) {
-      assert(!st[etmp->item.id]);
-      st[etmp->item.id] = true;
-      dfs_spanning_tree(g, color, u, st);
+  long u, v, k;
+
+  ctx_touch(sc, s);
+  sc->aux[s] = g->out_offset[s];
+  u = s;
+  while (u != NS) {
+    if (sc->aux[u] < g->out_offset[u+1]) {
+      k = sc->aux[u];
+      v = g->out_to[k];
+      sc->aux[u]++;
+      if (!ctx_seen(sc, v)) {
+        assert(!st[g->out_id[k]]);
+        st[g->out_id[k]] = true;
+        ctx_touch(sc, v);
+        sc->pred[v] = u;
+        sc->aux[v] = g->out_offset[v];
+        u = v;
+      }
+    } else {
+      u = sc->pred[u];
     }
   }
 }
@@ -888,10 +1216,10 @@ static void dfs_spanning_tree(const struct graph *g, color_e *color, long v, boo
  * Return a array with the id of the edges
  * that are part of the spanning_tree of the graph
  */
-bool *get_spanning_tree(const struct graph *g)
+bool *get_spanning_tree(const struct csr_graph *g)
 {
   long i, n;
-  color_e *color;
+  struct search_ctx sc;
   bool *st;
   size_t alloc;
 
@@ -899,61 +1227,67 @@ bool *get_spanning_tree(const struct graph *g)
   st = (bool *)xmalloc(alloc);
   memset(st, false, alloc);
   n = g->n_nodes;
-  color = (color_e *)xmalloc(n*sizeof(color_e));
-
-  for (i = 0; i < n; i++) {
-    color[i] = WHITE;
-  }
+  init_search_ctx(&sc, n);
+  search_ctx_reset(&sc);
   for (i = ROOT; i < n; i++) {
-    if (color[i] == WHITE) {
-      dfs_spanning_tree(g, color, i, st);
+    if (!ctx_seen(&sc, i)) {
+      dfs_spanning_tree(g, &sc, i, st);
     }
   }
+  free_search_ctx(&sc);
   return st;
 }
 
-static void dfs_euler_tour(const struct graph *g, color_e *color,
-			   long v, VEC(long) *et)
+static void dfs_euler_tour(const struct csr_graph *g, struct search_ctx *sc,
+			   long s, VEC(long) *et)
 {
-  long u;
-  struct edge_list *etmp;
-
-  color[v] = BLACK;
-  adj_for_each(etmp, g->adj_list[v]) {
-    u = etmp->item.to;
-    if (color[u] == WHITE) {
-      printf("depth %ld\n", u);
-      VEC_PUSH(long, *et, u);
-      dfs_euler_tour(g, color, u, et);
-      printf("bt %ld\n", v);
-      VEC_PUSH(long, *et, v);
+  long u, v;
+
+  ctx_touch(sc, s);
+  sc->aux[s] = g->out_offset[s];
+  u = s;
+  while (u != NS) {
+    if (sc->aux[u] < g->out_offset[u+1]) {
+      v = g->out_to[sc->aux[u]];
+      sc->aux[u]++;
+      if (!ctx_seen(sc, v)) {
+        VEC_PUSH(long, *et, v);
+        ctx_touch(sc, v);
+        sc->pred[v] = u;
+        sc->aux[v] = g->out_offset[v];
+        u = v;
+      }
+    } else {
+      u = sc->pred[u];
+      if (u != NS) {
+        VEC_PUSH(long, *et, u);
+      }
     }
   }
 }
 
 /**
- * Return a vector with the edges of the euler tour
+ * Return a vector with the nodes of the euler tour of the depth first
+ * spanning forest of g. A node is added when it is entered and again
+ * after the tour of each of its children.
  */
-VEC(long) *get_euler_tour(const struct graph *g)
+VEC(long) *get_euler_tour(const struct csr_graph *g)
 {
   long i, n;
-  color_e *color;
+  struct search_ctx sc;
   VEC(long) *etour;
 
   etour = (VEC(long) *)xmalloc(sizeof(VEC(long)));
   n = g->n_nodes;
   VEC_INIT(long, *etour);
-  color = (color_e *)xmalloc(n*sizeof(color_e));
-
-  for (i = 0; i < n; i++) {
-    color[i] = WHITE;
-  }
+  init_search_ctx(&sc, n);
+  search_ctx_reset(&sc);
   for (i = ROOT; i < n; i++) {
-    if (color[i] == WHITE) {
-      printf("init add %ld\n", i);
+    if (!ctx_seen(&sc, i)) {
       VEC_PUSH(long, *etour, i);
-      dfs_euler_tour(g, color, i, etour);
+      dfs_euler_tour(g, &sc, i, etour);
     }
   }
+  free_search_ctx(&sc);
   return etour;
 }
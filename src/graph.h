@@ -38,6 +38,47 @@ struct graph {
   struct edge_list *_tmp;
 };
 
+/**
+ * Frozen graph in compressed sparse row format. The arcs that leave
+ * the node u are stored in the positions out_offset[u] to
+ * out_offset[u+1]-1 of the arrays out_to, out_cost and out_id. The
+ * arcs that enter u are stored in the same way in the in_* arrays.
+ */
+struct csr_graph {
+  long n_nodes;
+  long n_edges;
+  long *out_offset;
+  long *out_to;
+  long *out_cost;
+  long *out_id;
+  long *in_offset;
+  long *in_from;
+  long *in_cost;
+  long *in_id;
+  bool is_view;
+};
+
+/**
+ * Buffers of the size of the graph used by the searches. A context is
+ * owned by one thread and reused by all its searches. Every search
+ * takes a new generation, and the entries of a node are valid only
+ * when its stamp is equal to the current generation, so the buffers
+ * are never cleared between searches. heap and pos are the storage of
+ * the priority queue of min_paths.
+ */
+struct search_ctx {
+  long n_nodes;
+  unsigned long gen;
+  unsigned long *stamp;
+  long *val;
+  long *aux;
+  long *pred;
+  char *mark;
+  long *heap;
+  long *pos;
+  VEC(long) touched;
+};
+
 typedef int (*edge_cost_fn_t)(const struct edge *);
 
 /**
@@ -85,6 +126,24 @@ typedef int (*edge_cost_fn_t)(const struct edge *);
        &((edge)->list) != &((adj_head).list);                           \
        edge = tmp, tmp = list_entry(((tmp)->list).next, struct edge_list, list))
 
+/**
+ * Iterate over the positions of the arcs that leave a node
+ * @k:      long, position of the arc in the out_* arrays
+ * @cg:     struct csr_graph *
+ * @u:      long, source node
+ */
+#define csr_for_each_out(k, cg, u)					\
+  for (k = (cg)->out_offset[(u)]; k < (cg)->out_offset[(u)+1]; k++)
+
+/**
+ * Iterate over the positions of the arcs that enter a node
+ * @k:      long, position of the arc in the in_* arrays
+ * @cg:     struct csr_graph *
+ * @u:      long, target node
+ */
+#define csr_for_each_in(k, cg, u)					\
+  for (k = (cg)->in_offset[(u)]; k < (cg)->in_offset[(u)+1]; k++)
+
 void set_edge(struct edge *e, long id, long from, long to, long c);
 
 void init_graph(struct graph *g, long nodes);
@@ -103,33 +162,85 @@ void free_edge_item(struct edge_list *el);
 
 void free_graph(struct graph *g);
 
-void dfs_search(const struct graph *g, long s, long *d, long *f, long *pred);
+void csr_build(struct csr_graph *cg, const struct graph *g);
+
+void csr_build_edges(struct csr_graph *cg, long n, const struct edge *e, long m);
+
+void csr_reverse(const struct csr_graph *cg, struct csr_graph *rev);
 
-long min_distance(const struct graph *g, long s, long t);
+void free_csr_graph(struct csr_graph *cg);
 
-void all_pairs_shortest(const struct graph *g, long **dist);
+void print_csr_graph(const struct csr_graph *cg);
+
+void init_search_ctx(struct search_ctx *sc, long n);
+
+void free_search_ctx(struct search_ctx *sc);
+
+void search_ctx_reset(struct search_ctx *sc);
+
+/**
+ * Results of the last search of a context for the node v, NS (-1)
+ * if v was not reached by the search
+ */
+static inline long search_ctx_pred(const struct search_ctx *sc, long v)
+{
+  return (sc->stamp[v] == sc->gen) ? sc->pred[v] : -1;
+}
+
+static inline long search_ctx_d(const struct search_ctx *sc, long v)
+{
+  return (sc->stamp[v] == sc->gen) ? sc->val[v] : -1;
+}
+
+static inline long search_ctx_f(const struct search_ctx *sc, long v)
+{
+  return (sc->stamp[v] == sc->gen) ? sc->aux[v] : -1;
+}
+
+void dfs_search(const struct csr_graph *g, long s, struct search_ctx *sc);
+
+void dfs_postorder(const struct csr_graph *g, long s, struct search_ctx *sc,
+                   VEC(long) *order);
+
+struct hop_labels;
+
+void set_distance_labels(const struct csr_graph *g, const struct hop_labels *hl);
+
+long min_distance(const struct csr_graph *g, long s, long t, struct search_ctx *sc);
+
+struct reach_index;
+
+long min_distance_reach(const struct csr_graph *g, long s, long t,
+                        const struct reach_index *ri, struct search_ctx *sc);
+
+void all_pairs_shortest(const struct csr_graph *g, long **dist);
 
 void graph_inverse(const struct graph *orig, struct graph *inv);
 
 void graph_undirect(const struct graph *orig, struct graph *ud);
 
-long max_distance(const struct graph *g, long s, long t);
+long max_distance(const struct csr_graph *g, long s, long t, struct search_ctx *sc);
+
+void min_paths(const struct csr_graph *g, long start, const long *goals, long n_goals,
+               long *dist, struct search_ctx *sc);
+
+long min_path(const struct csr_graph *g, long start, long goal, struct search_ctx *sc);
 
-long min_path(const struct graph *g, long start, long goal);
+struct long_list *topological_sort(const struct csr_graph *g, long s);
 
-struct long_list *topological_sort(const struct graph *g, long s);
+void calculate_root_distances(const struct csr_graph *g, long *dmin, long *dmax);
 
-long *calculate_depth(const struct graph *g);
+long *calculate_depth(const struct csr_graph *g);
 
 void add_reprensentative_ancestor(struct graph *g);
 
-long *calculate_depth_bfs(const struct graph *g);
+long *calculate_depth_bfs(const struct csr_graph *g);
 
-bool detect_cycle(const struct graph *g);
+bool detect_cycle(const struct csr_graph *g);
 
-bool *get_spanning_tree(const struct graph *g);
+bool *get_spanning_tree(const struct csr_graph *g);
 
-VEC(long) *get_euler_tour(const struct graph *g);
+VEC(long) *get_euler_tour(const struct csr_graph *g);
 
 bool find_edge(struct graph *g, long v1, long v2);
 
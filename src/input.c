@@ -5,595 +5,638 @@
  * @author Guillermo Palma <gpalma@ldc.usb.ve>
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 #include "types.h"
 #include "graph.h"
 #include "memory.h"
-#include "hash_map.h"
+#include "arena.h"
+#include "term_map.h"
 #include "util.h"
 #include "input.h"
 
-#define HASH_SZ   503
-#define BUFSZ     128
-#define COST      1
+#define COST         1
+/* Smallest part of a file parsed by a thread */
+#define PARSE_CHUNK  (1 << 20)
 
-struct arc {
-  char *from;
-  char *to;
-  long cost;
+/**
+ * A string inside a mapped file. It does not end with '\0'.
+ */
+struct str_view {
+  const char *str;
+  unsigned len;
 };
 
-struct graph_data {
-  long n_nodes;
-  long n_arcs;
-  struct arc *larcs;
-};
+typedef struct str_view str_view;
+DEFINE_VEC(str_view);
 
 struct term {
-  char *name;
-  char *description;
+  struct str_view name;
+  struct str_view description;
 };
 
-struct term_data
-{
-  long nr;
-  struct term *term_array;
-};
 
-struct concept {
-  long pos;
-  struct hash_entry entry;
-};
-
-struct char_array {
-  unsigned nr;
-  unsigned alloc;
-  char *str;
+struct view_array {
+  long nr;
+  struct str_view *views;
 };
 
-struct string_array {
-  unsigned nr;
-  char **strs;
+/**
+ * A file mapped in memory. data is NULL for an empty file.
+ */
+struct mapped_file {
+  const char *data;
+  size_t size;
 };
 
-enum node {
-  ROOT,
-  NOROOT
-};
+typedef void (*parse_line_fn)(const char *p, const char *eol, void *rec,
+                              const void *arg);
 
-struct node_type {
-  enum node ntype;
-  struct hash_entry entry;
+/**
+ * Part [begin, end) of a file, cut at the beginning of a line, whose
+ * lines are the records [first, first + n_lines) of recs
+ */
+struct parse_chunk {
+  const char *begin;
+  const char *end;
+  long first;
+  long n_lines;
+  char *recs;
+  size_t rec_size;
+  parse_line_fn parse;
+  const void *arg;
 };
 
 /*********************************
  ** String processing
  *********************************/
 
-static inline void add_char(struct char_array *buf, char ch)
+static void map_file(struct mapped_file *mf, const char *filename)
 {
-  unsigned alloc, nr;
+  int fd;
+  struct stat st;
+  void *data;
 
-  alloc = buf->alloc;
-  nr = buf->nr;
-  if (nr == alloc) {
-    alloc = BUFSZ + alloc;
-    buf->str = xrealloc(buf->str, alloc);
-    buf->alloc = alloc;
+  fd = open(filename, O_RDONLY);
+  if (fd == -1)
+    fatal("No instance file specified, abort\n");
+  if (fstat(fd, &st) == -1)
+    fatal("Error reading the file %s\n", filename);
+  mf->data = NULL;
+  mf->size = st.st_size;
+  if (mf->size > 0) {
+    data = mmap(NULL, mf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+      fatal("Error mapping the file %s\n", filename);
+    madvise(data, mf->size, MADV_SEQUENTIAL);
+    mf->data = (const char *)data;
   }
-  buf->str[nr] = ch;
-  buf->nr++;
+  close(fd);
 }
 
-static inline void init_char_array(struct char_array *buf)
+static void unmap_file(struct mapped_file *mf)
 {
-  buf->str = xcalloc(BUFSZ, 1);
-  buf->alloc = BUFSZ;
-  buf->nr = 0;
+  if (mf->data)
+    munmap((void *)mf->data, mf->size);
+  mf->data = NULL;
+  mf->size = 0;
 }
 
-static inline void string_clean(struct char_array *buf)
+static inline struct str_view make_view(const char *str, const char *end)
 {
-  buf->nr = 0;
+  struct str_view v;
+
+  v.str = str;
+  v.len = end - str;
+  return v;
 }
 
-static void free_array_char(struct char_array *buf)
+static inline bool view_equal(struct str_view a, struct str_view b)
 {
-  buf->nr = 0;
-  buf->alloc = 0;
-  free(buf->str);
+  return (a.len == b.len) && !memcmp(a.str, b.str, a.len);
 }
 
-/*********************************
- ** Graph processing
- *********************************/
+/**
+ * Position of the first tab or newline in [p, end), or end. The
+ * characters are compared 16 at a time.
+ */
+static inline const char *next_separator(const char *p, const char *end)
+{
+#if defined(__SSE2__)
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i nl = _mm_set1_epi8('\n');
+  __m128i c;
+  int m;
+
+  while (end - p >= 16) {
+    c = _mm_loadu_si128((const __m128i *)p);
+    m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(c, tab), _mm_cmpeq_epi8(c, nl)));
+    if (m)
+      return p + __builtin_ctz(m);
+    p += 16;
+  }
+#endif
+  while ((p < end) && (*p != '\t') && (*p != '\n'))
+    p++;
+  return p;
+}
 
-static void initialize_graph(struct graph_data *g, long n_nodes, long n_arcs)
+/**
+ * Position of the end of the line that begins at p
+ */
+static inline const char *end_of_line(const char *p, const char *end)
 {
-  g->n_nodes = n_nodes;
-  g->n_arcs = n_arcs;
+  const char *e;
 
-  g->larcs = xcalloc(n_arcs, sizeof(struct arc));
+  e = memchr(p, '\n', end - p);
+  return e ? e : end;
 }
 
-static void free_graph_data(struct graph_data *g)
+static inline const char *next_line(const char *eol, const char *end)
 {
-  long i;
-
-  for (i = 0; i < g->n_arcs; i++) {
-    free(g->larcs[i].from);
-    free(g->larcs[i].to);
-  }
-  free(g->larcs);
-  g->n_nodes = 0;
-  g->n_arcs = 0;
+  return (eol < end) ? eol + 1 : end;
 }
 
-static long graph_loading(struct graph_data *gd, const char *graph_filename)
+/**
+ * Integer in [p, end). Spaces and a carriage return are allowed after
+ * the digits.
+ */
+static long parse_long(const char *p, const char *end)
 {
-  FILE *f;
-  struct char_array buf;
-  long cont_arcs, n, l;
-  int ch, tok;
-  size_t len;
+  long n;
+  bool neg, digits;
 
-  f = fopen(graph_filename, "r");
-  if (!f) {
-    fatal("No instance file specified, abort\n");
+  neg = false;
+  if ((p < end) && ((*p == '-') || (*p == '+'))) {
+    neg = (*p == '-');
+    p++;
   }
   n = 0;
-  l = 0;
-  init_char_array(&buf);
-  ch = getc(f);
-  errno = 0;
-  /* read number of nodes and arcs */
-  while((ch != '\n') && (ch != EOF)) {
-    if (ch == '\t') {
-      add_char(&buf, '\0');
-      n = strtol(buf.str, NULL, 10);
-      if (errno)
-        fatal("Error in the conversion of string to integer\n");
-      string_clean(&buf);
-    } else {
-      add_char(&buf, ch);
-    }
-    ch = getc(f);
-  }
-  if (ch != EOF) {
-    add_char(&buf, '\0');
-    l = strtol(buf.str, NULL, 10);
-    if (errno)
+  digits = false;
+  while ((p < end) && (*p >= '0') && (*p <= '9')) {
+    if (n > (LONG_MAX - (*p - '0'))/10)
       fatal("Error in the conversion of string to integer\n");
-  } else {
-    fatal("Error reading the graph data file\n");
+    n = 10*n + (*p - '0');
+    digits = true;
+    p++;
   }
-  string_clean(&buf);
-  initialize_graph(gd, n, l);
-  /* read graphs arcs */
-  ch = getc(f);
-  if (ch == EOF) {
-    fatal("Error reading the graph data file\n");
-  }
-  tok = 1;
-  cont_arcs = 0;
-  while ((ch != EOF) && (cont_arcs < l)) {
-    if ((ch != '\t') && (ch != '\n')) {
-      add_char(&buf, ch);
-    } else {
-      add_char(&buf, '\0');
-      if (ch == '\t') {
-        len = strlen(buf.str) + 1;
-        assert(len > 1);
-        if (tok == 1) {
-          gd->larcs[cont_arcs].from = xmalloc(len);
-          strcpy(gd->larcs[cont_arcs].from, buf.str);
-        } else if (tok == 2) {
-          gd->larcs[cont_arcs].to = xmalloc(len);
-          strcpy(gd->larcs[cont_arcs].to, buf.str);
-        } else {
-          fatal("Error in graph format\n");
-        }
-        tok++;
-      } else {
-        assert(ch == '\n');
-        if (tok != 3)
-          fatal("Error in graph format\n");
-        gd->larcs[cont_arcs].cost = strtol(buf.str, NULL, 10);
-        if (errno)
-          fatal("Error in the conversion of string to integer\n");
-        cont_arcs++;
-        tok = 1;
-      }
-      string_clean(&buf);
-    }
-    ch = getc(f);
-  }
-  fclose(f);
-  free_array_char(&buf);
-  if (cont_arcs < l)
-    fatal("Incorrect number of arcs\n");
-  return n;
+  while ((p < end) && ((*p == ' ') || (*p == '\r')))
+    p++;
+  if (!digits || (p != end))
+    fatal("Error in the conversion of string to integer\n");
+  return neg ? -n : n;
 }
 
-#ifdef PRGDEBUG
-static void print_graph_data(const struct graph_data *gd)
+static void *count_lines_worker(void *args)
 {
-  long i;
+  struct parse_chunk *c;
+  const char *p;
 
-  printf("Nodes %ld -- Arcs %ld\n", gd->n_nodes, gd->n_arcs);
-  for (i = 0; i < gd->n_arcs; i++) {
-    printf("%s\t%s\t%ld\n", gd->larcs[i].from, gd->larcs[i].to, gd->larcs[i].cost);
-  }
+  c = (struct parse_chunk *)args;
+  c->n_lines = 0;
+  for (p = c->begin; p < c->end; p = next_line(end_of_line(p, c->end), c->end))
+    c->n_lines++;
+  return NULL;
 }
-#endif
 
-/*********************************
- ** Ontology terms processing
- *********************************/
-
-static void free_terms(struct term *t)
+static void *parse_lines_worker(void *args)
 {
-  free(t->name);
-  free(t->description);
+  struct parse_chunk *c;
+  const char *p, *eol;
+  long i;
+
+  c = (struct parse_chunk *)args;
+  p = c->begin;
+  for (i = 0; i < c->n_lines; i++) {
+    eol = end_of_line(p, c->end);
+    c->parse(p, eol, c->recs + (c->first + i)*c->rec_size, c->arg);
+    p = next_line(eol, c->end);
+  }
+  return NULL;
 }
 
-static void free_term_data(struct term_data *td)
+static void run_chunks(void *(*worker)(void *), struct parse_chunk *chunks, unsigned n)
 {
-  long i;
+  pthread_t thread[n];
+  unsigned i;
+  int tc;
 
-  for (i = 0; i < td->nr; i++)
-    free_terms(&td->term_array[i]);
-  td->nr = 0;
-  free(td->term_array);
+  for (i = 1; i < n; i++) {
+    tc = pthread_create(&thread[i], NULL, worker, (void *)&chunks[i]);
+    if (tc)
+      fatal("ERROR; return code from pthread_create() is %d\n", tc);
+  }
+  worker((void *)&chunks[0]);
+  for (i = 1; i < n; i++) {
+    tc = pthread_join(thread[i], NULL);
+    if (tc)
+      fatal("ERROR; return code from pthread_join() is %d\n", tc);
+  }
 }
 
-static void initialize_terms(struct term_data *td, long n)
-{
-  td->nr = n;
-  td->term_array = xcalloc(n, sizeof(struct term));
+/**
+ * Parse the first n_recs lines of [p, end) into the array recs with
+ * n_threads threads, and return the number of lines parsed. The text
+ * is cut in chunks at the beginning of a line. The threads first count
+ * the lines of their chunks, and then each one parses its chunk into
+ * its part of recs, so the records keep the order of the file.
+ */
+static long parse_lines(const char *p, const char *end, long n_recs, void *recs,
+                        size_t rec_size, parse_line_fn parse, const void *arg,
+                        unsigned n_threads)
+{
+  unsigned i, n;
+  size_t size;
+  long total;
+  const char *b;
+  struct parse_chunk *chunks;
+
+  size = end - p;
+  n = size/PARSE_CHUNK + 1;
+  if (n > n_threads)
+    n = n_threads;
+  if (n == 0)
+    n = 1;
+  chunks = (struct parse_chunk *)xmalloc(n*sizeof(struct parse_chunk));
+  chunks[0].begin = p;
+  for (i = 1; i < n; i++) {
+    b = p + (size/n)*i;
+    if (b < chunks[i-1].begin)
+      b = chunks[i-1].begin;
+    else if (b > p)
+      b = next_line(end_of_line(b - 1, end), end);
+    chunks[i].begin = b;
+    chunks[i-1].end = b;
+  }
+  chunks[n-1].end = end;
+  run_chunks(count_lines_worker, chunks, n);
+  total = 0;
+  for (i = 0; i < n; i++) {
+    chunks[i].first = total;
+    total += chunks[i].n_lines;
+    if (chunks[i].first >= n_recs)
+      chunks[i].n_lines = 0;
+    else if (total > n_recs)
+      chunks[i].n_lines = n_recs - chunks[i].first;
+    chunks[i].recs = (char *)recs;
+    chunks[i].rec_size = rec_size;
+    chunks[i].parse = parse;
+    chunks[i].arg = arg;
+  }
+  run_chunks(parse_lines_worker, chunks, n);
+  free(chunks);
+  return (total < n_recs) ? total : n_recs;
 }
 
-static void load_of_terms(struct term_data *td, const char *desc_filename, 
-			  bool description)
+/*********************************
+ ** Ontology terms processing
+ *********************************/
+
+/**
+ * Term of the line [p, eol), with the format name<TAB>description. arg
+ * points to a bool, false if the name is also the description.
+ */
+static void parse_term(const char *p, const char *eol, void *rec, const void *arg)
+{
+     const char *tab;
+     struct term *t;
+
+     t = (struct term *)rec;
+     tab = next_separator(p, eol);
+     if ((tab == eol) || (tab == p))
+	  fatal("Error in term file format\n");
+     if (next_separator(tab + 1, eol) != eol)
+	  fatal("Error in term file format\n");
+     t->name = make_view(p, tab);
+     if (*(const bool *)arg)
+	  t->description = make_view(tab + 1, eol);
+     else
+	  t->description = t->name;
+}
+
+/**
+ * The n_nodes terms of the graph, with room for one more. The terms
+ * keep views of the mapping of the file until they are interned.
+ */
+static struct term *load_of_terms(struct mapped_file *mf, const char *desc_filename,
+				  long n_nodes, bool description, unsigned n_threads)
 {
-     FILE *f;
-     struct char_array buf;
-     long n, i;
-     int ch, tok;
-     size_t len;
+     const char *p, *end, *eol;
+     long n;
+     struct term *terms;
 
-     f = fopen(desc_filename, "r");
-     if (!f) {
-	  fatal("No instance file specified, abort\n");
-     }
-     n = 0;
-     init_char_array(&buf);
-     ch = getc(f);
-     errno = 0;
+     map_file(mf, desc_filename);
+     p = mf->data;
+     end = p + mf->size;
      /* read number of terms */
-     while((ch != '\n') && (ch != EOF)) {
-	  add_char(&buf, ch);
-	  ch = getc(f);
-     }
-     if (ch != EOF) {
-	  add_char(&buf, '\0');
-	  n = strtol(buf.str, NULL, 10);
-	  if (errno)
-	       fatal("Error in the conversion of string to integer\n");
-     } else {
+     eol = (mf->size > 0) ? end_of_line(p, end) : end;
+     if (eol == end)
 	  fatal("Error reading the description data file\n");
-     }
-     string_clean(&buf);
-     initialize_terms(td, n);
+     n = parse_long(p, eol);
+     if (n < 0)
+	  fatal("Error reading the description data file\n");
+     terms = xmalloc((n + 1)*sizeof(struct term));
      /* read the terms */
-     ch = getc(f);
-     if (ch == EOF) {
+     p = next_line(eol, end);
+     if (parse_lines(p, end, n, terms, sizeof(struct term), parse_term,
+		     &description, n_threads) < n)
 	  fatal("Error reading the description data file\n");
-     }
-     tok = 1;
-     i = 0;
-     while ((ch != EOF) && (i < n)) {
-	  if ((ch != '\t') && (ch != '\n')) {
-	       add_char(&buf, ch);
-	  } else {
-	       add_char(&buf, '\0');
-	       if (ch == '\t') {
-		    if (tok != 1)
-			 fatal("Error in term file format\n");
-		    len = strlen(buf.str) + 1;
-		    assert(len > 1);
-		    td->term_array[i].name = xmalloc(len);
-		    strcpy(td->term_array[i].name, buf.str);
-		    tok++;
-		    if (!description) {
-			 td->term_array[i].description = xmalloc(len);
-			 strcpy(td->term_array[i].description, buf.str);
-		    }
-	       } else {
-		    assert(ch == '\n');
-		    if (tok != 2)
-			 fatal("Error in term file format\n");
-		    if (description) {
-			 len = strlen(buf.str) + 1;
-			 assert(len > 1);
-			 td->term_array[i].description = xmalloc(len);
-			 strcpy(td->term_array[i].description, buf.str);
-		    }
-		    i++;
-		    tok = 1;
-	       }
-	       string_clean(&buf);
-	  }
-	  ch = getc(f);
-     }
-     fclose(f);
-     free_array_char(&buf);
+     if (n != n_nodes)
+	  fatal("Number of nodes of the graph is diferent to the number of terms");
+     return terms;
 }
 
 #ifdef PRGDEBUG
-static void print_term_data(const struct term_data *td)
+static void print_terms(const struct term *terms, long n)
 {
   long i;
 
-  printf("\nNumber of terms %ld\n", td->nr);
+  printf("\nNumber of terms %ld\n", n);
   printf("Name\tDescriptions\n");
-  for (i = 0; i < td->nr; i++) {
-    printf("%s\t%s\n", td->term_array[i].name, td->term_array[i].description);
+  for (i = 0; i < n; i++) {
+    printf("%.*s\t%.*s\n", terms[i].name.len, terms[i].name.str,
+           terms[i].description.len, terms[i].description.str);
   }
 }
 #endif
 
-static void initialize_string_array(struct string_array *sa, long n)
+/**
+ * Copy the names and the descriptions of the n terms to the arena, in
+ * one buffer of the exact size, and move the views of the terms to the
+ * copies. A description equal to the name shares its copy. The term n
+ * is the root added to an ontology with several roots, so all the
+ * strings are in the arena before the map of terms is built on it. The
+ * copies are kept as handles until the last one is added, so the views
+ * stay valid even if the arena grows.
+ */
+static void intern_terms(struct str_arena *a, struct term *terms, long n,
+                         bool description)
 {
-  sa->nr = n;
-  sa->strs = xmalloc(n*sizeof(char *));
+  long i, *name, *desc;
+  size_t size;
+  static const char root_name[] = "ROOT";
+  static const char root_desc[] = "Ontology Root";
+
+  size = sizeof(root_name) + sizeof(root_desc);
+  for (i = 0; i < n; i++) {
+    size += terms[i].name.len + 1;
+    if (description)
+      size += terms[i].description.len + 1;
+  }
+  init_str_arena(a, size);
+  name = (long *)xmalloc(2 * (n + 1) * sizeof(long));
+  desc = name + n + 1;
+  terms[n].name = make_view(root_name, root_name + strlen(root_name));
+  terms[n].description = make_view(root_desc, root_desc + strlen(root_desc));
+  for (i = 0; i <= n; i++) {
+    name[i] = str_arena_add(a, terms[i].name.str, terms[i].name.len);
+    if (description || (i == n))
+      desc[i] = str_arena_add(a, terms[i].description.str, terms[i].description.len);
+    else
+      desc[i] = name[i];
+  }
+  for (i = 0; i <= n; i++) {
+    terms[i].name.str = str_arena_get(a, name[i]);
+    if (desc[i] == name[i])
+      terms[i].description = terms[i].name;
+    else
+      terms[i].description.str = str_arena_get(a, desc[i]);
+  }
+  free(name);
 }
 
-static void free_string_array(struct string_array *sa)
+/**
+ * Handle of a view of a string of the arena a
+ */
+static inline long view_handle(const struct str_arena *a, struct str_view v)
 {
-  for (long i = 0; i < sa->nr; i++)
-    free(sa->strs[i]);
-  free(sa->strs);
-  sa->nr = 0;
+  return v.str - a->buf;
 }
 
-static void annotations_load(struct string_array *sa, const char *annt_filename)
+/**
+ * The keys of the map are the handles of the names of the terms in the
+ * arena, with room for the root added to an ontology with several roots
+ */
+static void map_term_pos(struct term_map *tm, const struct str_arena *a,
+                         const struct term *terms, long n)
 {
-  FILE *f;
-  char buf[128];
-  size_t len;
-  long i, n;
+  long i;
 
-  f = fopen(annt_filename, "r");
-  if (!f) {
-    fatal("No instance file specified, abort\n");
-  }
-  i = 0;
-  if (fgets(buf, sizeof(buf), f) == NULL)
-    fatal("Error reading file");
-  errno = 0;
-  n = strtol(buf, NULL, 10);
-  if (errno)
-    fatal("Error in the conversion of string to integer\n");
-  initialize_string_array(sa, n);
+  init_term_map(tm, a, n + 1);
   for (i = 0; i < n; i++) {
-    if (fgets(buf, sizeof(buf), f) == NULL)
-      fatal("Error reading file");
-    len = strlen(buf) - 1;
-    if(buf[len] ==  '\n')
-      buf[len] = '\0';
-    sa->strs[i] = xcalloc(len+1, sizeof(char));
-    strcpy(sa->strs[i], buf);
+    if (term_map_add(tm, view_handle(a, terms[i].name), terms[i].name.len, i) != -1)
+      fatal("Error, term repeated in the file term-description\n");
   }
-  fclose(f);
 }
 
 #ifdef PRGDEBUG
-static void print_string_array(struct string_array *sa)
+static void print_hash_term(const struct term_map *tm)
 {
-  long i;
+  long k;
+  const struct term_slot *slot;
 
-  printf("\nAnnotations\n");
-  for (i = 0; i < sa->nr; i++)
-    printf("%s\n", sa->strs[i]);
-  printf("\n");
+  printf("\nMap term-position\n");
+  term_map_for_each(slot, k, tm) {
+    printf("** %s %ld\n", str_arena_get(tm->strings, slot->key), slot->value);
+  }
 }
 #endif
 
-/********************************************************************
- ** Generation of the internal representation of the ontology graph
- ********************************************************************/
-
-VEC(string) get_graph_roots(const struct graph_data *gd)
+/**
+ * Position of the term with the name v. The map is only read, so the
+ * threads of the parser share it.
+ */
+static inline long find_term(const struct term_map *tm, struct str_view v)
 {
-  long i;
-  VEC(string) roots;
-  struct hash_map root_set;
-  struct node_type *item;
-  struct hash_entry *hentry;
-  struct hlist_node *n;
-  size_t len;
-  char *term;
-
-  VEC_INIT(string, roots);
-  hmap_create(&root_set, HASH_SZ);
-  for (i = 0; i < gd->n_arcs; i++) {
-    len = strlen(gd->larcs[i].from);
-    hentry = hmap_find_member(&root_set, gd->larcs[i].from, len);
-    if (hentry == NULL) {
-      item = xmalloc(sizeof(struct node_type));
-      item->ntype = ROOT;
-      if (hmap_add(&root_set, &item->entry, gd->larcs[i].from, len) != 0)
-        fatal("Error in the set of roots");
-    }
-    len = strlen(gd->larcs[i].to);
-    hentry = hmap_find_member(&root_set, gd->larcs[i].to, len);
-    if (hentry == NULL) {
-      item = xmalloc(sizeof(struct node_type));
-      item->ntype = NOROOT;
-      if (hmap_add(&root_set, &item->entry, gd->larcs[i].to, len) != 0)
-        fatal("Error in the set of roots");
-    } else {
-      item = hash_entry(hentry, struct node_type, entry);
-      item->ntype = NOROOT;
-    }
-  }
-  hmap_for_each_safe(hentry, n, &root_set) {
-    item = hash_entry(hentry, struct node_type, entry);
-    if (item->ntype == ROOT) {
-      term = xmalloc(hentry->keylen+1);
-      strcpy(term, hentry->key);
-      VEC_PUSH(string, roots, term);
-    }
-    hmap_delete(&root_set, hentry);
-    free(item);
-  }
-  hmap_destroy(&root_set);
-
-  return roots;
+  return term_map_find(tm, v.str, v.len);
 }
 
-#ifdef PRGDEBUG
-static void print_ontology_roots(const VEC(string) *roots)
+/*********************************
+ ** Graph processing
+ *********************************/
+
+/**
+ * Map the graph file and read the number of nodes and arcs. Return
+ * the beginning of the arcs.
+ */
+static const char *graph_header(struct mapped_file *mf, const char *graph_filename,
+                                long *n_nodes, long *n_arcs)
 {
-  unsigned i;
-  char *term;
+  const char *p, *end, *eol, *tab;
 
-  printf("\nRoots of the ontology\n");
-  for (i = 0; i < VEC_SIZE(*roots); i++) {
-    term = VEC_GET(*roots, i);
-    printf("%s\n", term);
-  }
-  printf("\n");
+  map_file(mf, graph_filename);
+  p = mf->data;
+  end = p + mf->size;
+  if (mf->size == 0)
+    fatal("Error reading the graph data file\n");
+  eol = end_of_line(p, end);
+  if (eol == end)
+    fatal("Error reading the graph data file\n");
+  tab = next_separator(p, eol);
+  if (tab == eol)
+    fatal("Error reading the graph data file\n");
+  *n_nodes = parse_long(p, tab);
+  *n_arcs = parse_long(tab + 1, eol);
+  if ((*n_nodes < 0) || (*n_arcs < 0))
+    fatal("Error reading the graph data file\n");
+  return next_line(eol, end);
+}
+
+/**
+ * Arc of the line [p, eol), with the format from<TAB>to<TAB>cost. The
+ * names are resolved with the map of terms in arg.
+ */
+static void parse_arc(const char *p, const char *eol, void *rec, const void *arg)
+{
+  const char *e;
+  struct edge *a;
+  struct str_view name;
+  const struct term_map *tm;
+
+  tm = (const struct term_map *)arg;
+  a = (struct edge *)rec;
+
+  e = next_separator(p, eol);
+  if ((e == eol) || (e == p))
+    fatal("Error in graph format\n");
+  name = make_view(p, e);
+  a->from = find_term(tm, name);
+  if (a->from == -1)
+    fatal("Error, the term %.*s does not exist in the term list", name.len, name.str);
+  p = e + 1;
+  e = next_separator(p, eol);
+  if ((e == eol) || (e == p))
+    fatal("Error in graph format\n");
+  name = make_view(p, e);
+  a->to = find_term(tm, name);
+  if (a->to == -1)
+    fatal("Error; the term %.*s does not exist in the term list", name.len, name.str);
+  p = e + 1;
+  if (next_separator(p, eol) != eol)
+    fatal("Error in graph format\n");
+  a->cost = parse_long(p, eol);
 }
-#endif
 
-static void configure_the_single_root(struct graph_data *gd,
-                                      struct term_data *td,
-                                      const VEC(string) *roots)
+/**
+ * The n_arcs arcs of [p, end) with the positions of their terms, and
+ * room for an arc to each node from a new root
+ */
+static struct edge *graph_loading(const char *p, const char *end, long n_nodes,
+                                  long n_arcs, const struct term_map *tm,
+                                  unsigned n_threads)
 {
-  long i, j, alloc, nr;
-  char *term, *tmp;
-  const char *root_name = "ROOT";
-  const char *root_desc = "Ontology Root";
+  long i;
+  struct edge *arcs;
 
-  if (VEC_SIZE(*roots) == 1) {
-    term = VEC_GET(*roots, 0);
-    if (strcmp(term, td->term_array[0].name) != 0) {
-      for (i = 0; i < td->nr; i++) {
-        if (strcmp(term, td->term_array[i].name) == 0) {
-          tmp = td->term_array[i].name;
-          td->term_array[i].name = td->term_array[0].name;
-          td->term_array[0].name = tmp;
-          tmp = td->term_array[i].description;
-          td->term_array[i].description = td->term_array[0].description;
-          td->term_array[0].description = tmp;
-          break;
-        }
-      }
-    }
-  } else {
-    nr = td->nr;
-    td->term_array = xrealloc(td->term_array, (nr+1)*sizeof(struct term));
-    memmove(td->term_array+1, td->term_array, nr*sizeof(struct term));
-    td->nr++;
-    td->term_array[0].name = xmalloc(strlen(root_name)+1);
-    td->term_array[0].description = xmalloc(strlen(root_desc)+1);
-    strcpy(td->term_array[0].name, root_name);
-    strcpy(td->term_array[0].description, root_desc);
-    alloc = gd->n_arcs+VEC_SIZE(*roots);
-    gd->larcs = xrealloc(gd->larcs, alloc*sizeof(struct arc));
-    for (i = gd->n_arcs, j = 0; i < alloc; i++, j++) {
-      gd->larcs[i].from = xmalloc(strlen(root_name)+1);
-      strcpy(gd->larcs[i].from, root_name);
-      term = VEC_GET(*roots, j);
-      gd->larcs[i].to = xmalloc(strlen(term)+1);
-      strcpy(gd->larcs[i].to, term);
-      gd->larcs[i].cost = COST;
-    }
-    gd->n_arcs = alloc;
-    gd->n_nodes++;
+  arcs = xmalloc((n_arcs + n_nodes + 1)*sizeof(struct edge));
+  if (parse_lines(p, end, n_arcs, arcs, sizeof(struct edge), parse_arc, tm,
+                  n_threads) < n_arcs)
+    fatal("Incorrect number of arcs\n");
+  for (i = 0; i < n_arcs; i++) {
+    arcs[i].id = i;
   }
+  return arcs;
 }
 
 #ifdef PRGDEBUG
-static void print_hash_term(struct hash_map *term_pos)
+static void print_arcs(const struct edge *arcs, long n_nodes, long n_arcs)
 {
-  struct concept *item;
-  struct hash_entry *hentry;
+  long i;
 
-  printf("\nMap term-position\n");
-  hmap_for_each(hentry, term_pos) {
-    item = hash_entry(hentry, struct concept, entry);
-    printf("** %s %ld\n", hentry->key, item->pos);
+  printf("Nodes %ld -- Arcs %ld\n", n_nodes, n_arcs);
+  for (i = 0; i < n_arcs; i++) {
+    printf("%ld\t%ld\t%ld\n", arcs[i].from, arcs[i].to, arcs[i].cost);
   }
 }
 #endif
 
-static void free_map_term_pos(struct hash_map *term_pos)
+/*********************************
+ ** Annotations processing
+ *********************************/
+
+static void initialize_view_array(struct view_array *va, long n)
 {
-  struct concept *item;
-  struct hash_entry *hentry;
-  struct hlist_node *n;
+  va->nr = n;
+  va->views = xmalloc((n + 1)*sizeof(struct str_view));
+}
 
-  hmap_for_each_safe(hentry, n, term_pos) {
-    item = hash_entry(hentry, struct concept, entry);
-    hmap_delete(term_pos, hentry);
-    free(item);
-  }
-  hmap_destroy(term_pos);
+static void free_view_array(struct view_array *va)
+{
+  free(va->views);
+  va->nr = 0;
 }
 
-static void map_term_pos(struct hash_map *term_pos, const struct term_data *td)
+/**
+ * One term by line, of any length. The views point to the mapping of
+ * the file, so mf must outlive va.
+ */
+static void annotations_load(struct view_array *va, struct mapped_file *mf,
+                             const char *annt_filename)
 {
+  const char *p, *end, *eol;
   long i, n;
-  struct concept *item;
-  size_t len;
 
-  n = td->nr;
-  hmap_create(term_pos, n*2);
+  map_file(mf, annt_filename);
+  p = mf->data;
+  end = p + mf->size;
+  if (mf->size == 0)
+    fatal("Error reading file");
+  eol = end_of_line(p, end);
+  n = parse_long(p, eol);
+  if (n < 0)
+    fatal("Error reading file");
+  initialize_view_array(va, n);
+  p = next_line(eol, end);
   for (i = 0; i < n; i++) {
-    len = strlen(td->term_array[i].name);
-    item = xmalloc(sizeof(struct concept));
-    item->pos = i;
-    if (hmap_add_if_not_member(term_pos, &item->entry, td->term_array[i].name, len) != NULL)
-      fatal("Error, term repeated in the file term-description\n");
+    if (p == end)
+      fatal("Error reading file");
+    eol = end_of_line(p, end);
+    va->views[i] = make_view(p, eol);
+    p = next_line(eol, end);
   }
 }
 
 #ifdef PRGDEBUG
-static void print_descriptions(char **desc, long n)
+static void print_view_array(struct view_array *va)
 {
   long i;
 
-  printf("\nDescriptions\n");
-  for (i = 0; i < n; i++) {
-    printf("%s\n", desc[i]);
-  }
-  printf("********************\n");
+  printf("\nAnnotations\n");
+  for (i = 0; i < va->nr; i++)
+    printf("%.*s\n", va->views[i].len, va->views[i].str);
+  printf("\n");
 }
 #endif
 
-static char **get_descriptions(const struct term_data *td)
+static VEC(long) get_annotations(const struct view_array *va,
+                                 const struct term_map *tm)
 {
-  long i, n;
-  size_t len;
-  char **desc;
+  long i, n, pos;
+  VEC(long) annts;
 
-  n = td->nr;
-  desc = xcalloc(n, sizeof(char *));
+  n = va->nr;
+  VEC_INIT_N(long, annts, n);
   for (i = 0; i < n; i++) {
-    len = strlen(td->term_array[i].description);
-    desc[i] = xmalloc(len+1);
-    strcpy(desc[i], td->term_array[i].description);
+    pos = find_term(tm, va->views[i]);
+    if (pos == -1)
+      fatal("The term %.*s does not exist in the term list",
+            va->views[i].len, va->views[i].str);
+    VEC_PUSH(long, annts, pos);
   }
-  return desc;
+  return annts;
 }
 
 #ifdef PRGDEBUG
@@ -611,71 +654,137 @@ static void print_annotations(const VEC(long) *annts)
 }
 #endif
 
-static VEC(long) get_annotations(struct string_array *sa,
-                                 struct hash_map *term_pos)
+/********************************************************************
+ ** Generation of the internal representation of the ontology graph
+ ********************************************************************/
+
+/**
+ * The roots are the nodes that leave some arc and enter none, in
+ * increasing order
+ */
+static VEC(long) get_graph_roots(const struct edge *arcs, long n_nodes, long n_arcs)
 {
-  long i, n;
-  VEC(long) annts;
-  struct concept *item;
-  struct hash_entry *hentry;
-  size_t len;
+  long i;
+  VEC(long) roots;
+  struct valency *degree;
 
-  n = sa->nr;
-  VEC_INIT_N(long, annts, n);
-  for (i = 0; i < n; i++) {
-    len = strlen(sa->strs[i]);
-    hentry = hmap_find_member(term_pos, sa->strs[i], len);
-    if (hentry == NULL)
-      fatal("The term %s does not exist in the term list", sa->strs[i]);
-    item = hash_entry(hentry, struct concept, entry);
-    VEC_PUSH(long, annts, item->pos);
+  degree = xcalloc(n_nodes + 1, sizeof(struct valency));
+  for (i = 0; i < n_arcs; i++) {
+    degree[arcs[i].from].dout++;
+    degree[arcs[i].to].din++;
   }
-  return annts;
+  VEC_INIT(long, roots);
+  for (i = 0; i < n_nodes; i++) {
+    if ((degree[i].din == 0) && (degree[i].dout > 0))
+      VEC_PUSH(long, roots, i);
+  }
+  free(degree);
+  return roots;
 }
 
-static struct graph generate_internal_graph(const struct graph_data *gd,
-                                            struct hash_map *term_pos)
-{
-  long i, from, to;
-  struct graph g;
-  struct concept *item;
-  struct hash_entry *hentry;
-  size_t len;
-
-  init_graph(&g, gd->n_nodes);
-  for (i = 0; i < gd->n_arcs; i++) {
-
-    /* from node */
-    len =  strlen(gd->larcs[i].from);
-    hentry = hmap_find_member(term_pos, gd->larcs[i].from, len);
-    if (hentry == NULL)
-      fatal("Error, the term %s does not exist in the term list", gd->larcs[i].from);
-    item = hash_entry(hentry, struct concept, entry);
-    from = item->pos;
-
-    /* to node */
-    len =  strlen(gd->larcs[i].to);
-    hentry = hmap_find_member(term_pos, gd->larcs[i].to, len);
-    if (hentry == NULL)
-      fatal("Error; the term %s does not exist in the term list", gd->larcs[i].to);
-    item = hash_entry(hentry, struct concept, entry);
-    to = item->pos;
-
-    /* add to the graph */
-    add_arc_to_graph(&g, i, from, to, gd->larcs[i].cost);
+#ifdef PRGDEBUG
+static void print_ontology_roots(const VEC(long) *roots, const struct term *terms)
+{
+  unsigned i;
+  struct str_view term;
+
+  printf("\nRoots of the ontology\n");
+  for (i = 0; i < VEC_SIZE(*roots); i++) {
+    term = terms[VEC_GET(*roots, i)].name;
+    printf("%.*s\n", term.len, term.str);
   }
-  assert(g.n_edges == gd->n_arcs);
-  assert(g.n_nodes == term_pos->fill);
-  return g;
+  printf("\n");
 }
+#endif
 
-static void free_roots(VEC(string) *roots)
+static inline long swap_pos(long u, long a, long b)
 {
-  unsigned i;
+  if (u == a)
+    return b;
+  if (u == b)
+    return a;
+  return u;
+}
+
+/**
+ * Leave the root of the ontology at the position 0. A single root is
+ * swapped with the term at 0. Otherwise the term ROOT, kept by
+ * intern_terms after the n terms, is added at 0 with an arc to each
+ * root, and the other terms move one position. The arcs, the terms and
+ * the map of terms are renumbered in place.
+ */
+static void configure_the_single_root(struct edge *arcs, long *n_arcs,
+                                      struct term *terms, long *n_nodes,
+                                      struct term_map *tm, const VEC(long) *roots)
+{
+  long i, j, k, r, n, m;
+  struct term tmp;
+  struct term_slot *slot;
+
+  n = *n_nodes;
+  m = *n_arcs;
+  if (VEC_SIZE(*roots) == 1) {
+    r = VEC_GET(*roots, 0);
+    if (r == 0)
+      return;
+    for (i = 0; i < m; i++) {
+      arcs[i].from = swap_pos(arcs[i].from, 0, r);
+      arcs[i].to = swap_pos(arcs[i].to, 0, r);
+    }
+    tmp = terms[r];
+    terms[r] = terms[0];
+    terms[0] = tmp;
+    term_map_for_each(slot, k, tm) {
+      slot->value = swap_pos(slot->value, 0, r);
+    }
+  } else {
+    for (i = 0; i < m; i++) {
+      arcs[i].from++;
+      arcs[i].to++;
+    }
+    tmp = terms[n];
+    memmove(terms + 1, terms, n*sizeof(struct term));
+    terms[0] = tmp;
+    term_map_for_each(slot, k, tm) {
+      slot->value++;
+    }
+    if (term_map_add(tm, view_handle(tm->strings, terms[0].name), terms[0].name.len, 0) != -1)
+      fatal("Error, term repeated in the file term-description\n");
+    for (j = 0; j < (long)VEC_SIZE(*roots); j++) {
+      set_edge(&arcs[m], m, 0, VEC_GET(*roots, j) + 1, COST);
+      m++;
+    }
+    *n_arcs = m;
+    *n_nodes = n + 1;
+  }
+}
+
+#ifdef PRGDEBUG
+static void print_descriptions(const struct str_arena *a, const long *desc, long n)
+{
+  long i;
 
-  for (i = 0; i < VEC_SIZE(*roots); i++)
-     free(VEC_GET(*roots, i));
-  VEC_DESTROY(*roots);
+  printf("\nDescriptions\n");
+  for (i = 0; i < n; i++) {
+    printf("%s\n", str_arena_get(a, desc[i]));
+  }
+  printf("********************\n");
+}
+#endif
+
+/**
+ * Handles of the descriptions of the n terms, whose views are in a
+ */
+static long *get_descriptions(const struct str_arena *a, const struct term *terms, long n)
+{
+  long i;
+  long *desc;
+
+  desc = xmalloc((n + 1)*sizeof(long));
+  for (i = 0; i < n; i++) {
+    desc[i] = view_handle(a, terms[i].description);
+  }
+  return desc;
 }
 
 /*********************************
@@ -684,59 +793,67 @@ static void free_roots(VEC(string) *roots)
 
 void free_input_data(struct input_data *in)
 {
-  long i, n;
-
-  n = in->g.n_nodes;
-  free_graph(&in->g);
-  for (i = 0; i < n; i++) {
-    free(in->descriptions[i]);
-  }
+  free_csr_graph(&in->g);
+  free_str_arena(&in->strings);
   free(in->descriptions);
   VEC_DESTROY(in->anntt);
 }
 
+/**
+ * The three files are mapped in memory and parsed in place. The terms
+ * are read first and interned in the arena of strings, and the names
+ * of the arcs are resolved to the positions of the terms while the
+ * arcs are parsed, both by n_threads threads. The roots come from the
+ * degrees of the nodes, and the arcs are frozen in the graph without
+ * the adjacency lists.
+ */
 struct input_data get_input_ontology_data(const char *graph_filename,
                                           const char *desc_filename,
                                           const char *annt_filename, 
-					  bool description)
+					  bool description, unsigned n_threads)
 {
-  long n_nodes;
+  long n_nodes, n_arcs;
+  const char *arcs_text;
   struct input_data in;
-  struct graph_data gd;
-  struct term_data td;
-  struct string_array sa1;
-  VEC(string) roots;
-  struct hash_map term_pos;
-
-  n_nodes = graph_loading(&gd, graph_filename);
-  load_of_terms(&td, desc_filename, description);
-  if (td.nr != n_nodes)
-    fatal("Number of nodes of the graph is diferent to the number of terms");
-  annotations_load(&sa1, annt_filename);
-  roots = get_graph_roots(&gd);
-  configure_the_single_root(&gd, &td, &roots);
-  map_term_pos(&term_pos, &td);
-  in.descriptions = get_descriptions(&td);
-  in.anntt = get_annotations(&sa1, &term_pos);
-  in.g = generate_internal_graph(&gd, &term_pos);
+  struct term *terms;
+  struct edge *arcs;
+  struct view_array va;
+  struct mapped_file graph_file, desc_file, annt_file;
+  VEC(long) roots;
+  struct term_map term_pos;
+
+  arcs_text = graph_header(&graph_file, graph_filename, &n_nodes, &n_arcs);
+  terms = load_of_terms(&desc_file, desc_filename, n_nodes, description, n_threads);
+  intern_terms(&in.strings, terms, n_nodes, description);
+  unmap_file(&desc_file);
+  map_term_pos(&term_pos, &in.strings, terms, n_nodes);
+  arcs = graph_loading(arcs_text, graph_file.data + graph_file.size, n_nodes, n_arcs,
+                       &term_pos, n_threads);
+  annotations_load(&va, &annt_file, annt_filename);
+  roots = get_graph_roots(arcs, n_nodes, n_arcs);
+#ifdef PRGDEBUG
+  print_arcs(arcs, n_nodes, n_arcs);
+  print_terms(terms, n_nodes);
+  print_view_array(&va);
+  print_ontology_roots(&roots, terms);
+#endif
+  configure_the_single_root(arcs, &n_arcs, terms, &n_nodes, &term_pos, &roots);
+  in.descriptions = get_descriptions(&in.strings, terms, n_nodes);
+  in.anntt = get_annotations(&va, &term_pos);
+  csr_build_edges(&in.g, n_nodes, arcs, n_arcs);
 #ifdef PRGDEBUG
-  print_graph_data(&gd);
-  print_term_data(&td);
-  print_string_array(&sa1);
-  print_ontology_roots(&roots);
-  print_term_data(&td);
-  print_graph_data(&gd);
-  print_descriptions(in.descriptions, td.nr);
+  print_descriptions(&in.strings, in.descriptions, n_nodes);
   print_hash_term(&term_pos);
-  print_annotations(&in.anntt1);
-  print_annotations(&in.anntt2);
-  print_graph(&in.g);
+  print_annotations(&in.anntt);
+  print_csr_graph(&in.g);
 #endif
-  free_roots(&roots);
-  free_string_array(&sa1);
-  free_graph_data(&gd);
-  free_term_data(&td);
-  free_map_term_pos(&term_pos);
+  VEC_DESTROY(roots);
+  free(arcs);
+  free(terms);
+  free_view_array(&va);
+  free_term_map(&term_pos);
+  unmap_file(&graph_file);
+  unmap_file(&annt_file);
 
   return in;
 }
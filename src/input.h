@@ -8,16 +8,21 @@
 #ifndef ___INPUT_H
 #define ___INPUT_H
 
+/**
+ * The names and the descriptions of the terms are in the arena strings,
+ * descriptions[u] is the handle of the description of the node u
+ */
 struct input_data {
-  struct graph g;
+  struct csr_graph g;
   VEC(long) anntt;
-  char **descriptions;
+  struct str_arena strings;
+  long *descriptions;
 };
 
 struct input_data get_input_ontology_data(const char *graph_filename,
                                           const char *desc_filename,
                                           const char *annt_filename, 
-					  bool description);
+					  bool description, unsigned n_threads);
 
 void free_input_data(struct input_data *in);
 
@@ -0,0 +1,336 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Exact distances of a DAG by pruned 2-hop labels
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "labels.h"
+
+#define INFTY  INT_MAX
+
+struct rank_key {
+  long degree;
+  long depth;
+  long node;
+};
+
+static int rank_cmp(const void *a, const void *b)
+{
+  const struct rank_key *ka = (const struct rank_key *)a;
+  const struct rank_key *kb = (const struct rank_key *)b;
+
+  if (ka->degree != kb->degree)
+    return (ka->degree < kb->degree) - (ka->degree > kb->degree);
+  if (ka->depth != kb->depth)
+    return (ka->depth > kb->depth) - (ka->depth < kb->depth);
+  return (ka->node > kb->node) - (ka->node < kb->node);
+}
+
+/**
+ * Labels of the construction, with the hub and the distance of each
+ * entry one after the other
+ */
+struct label_build {
+  VEC(long) *out;
+  VEC(long) *in;
+};
+
+/**
+ * Binary heap of (distance, node) entries. A node can be inserted more
+ * than once, and only its entry with the current distance is used.
+ */
+struct dist_heap {
+  long size;
+  long *key;
+  long *node;
+};
+
+static void heap_push(struct dist_heap *h, long key, long node)
+{
+  long i, p;
+
+  i = h->size++;
+  while (i > 0) {
+    p = (i - 1)/2;
+    if (h->key[p] <= key)
+      break;
+    h->key[i] = h->key[p];
+    h->node[i] = h->node[p];
+    i = p;
+  }
+  h->key[i] = key;
+  h->node[i] = node;
+}
+
+static void heap_pop(struct dist_heap *h, long *key, long *node)
+{
+  long i, c, k, v;
+
+  *key = h->key[0];
+  *node = h->node[0];
+  h->size--;
+  k = h->key[h->size];
+  v = h->node[h->size];
+  i = 0;
+  for (;;) {
+    c = 2*i + 1;
+    if (c >= h->size)
+      break;
+    if ((c + 1 < h->size) && (h->key[c+1] < h->key[c]))
+      c++;
+    if (k <= h->key[c])
+      break;
+    h->key[i] = h->key[c];
+    h->node[i] = h->node[c];
+    i = c;
+  }
+  h->key[i] = k;
+  h->node[i] = v;
+}
+
+/**
+ * Distance through the hubs of the label l that are loaded in tmp
+ */
+static inline long label_query(const long *tmp, const VEC(long) *l)
+{
+  long i, d, min;
+
+  min = INFTY;
+  for (i = 0; i < (long)VEC_SIZE(*l); i += 2) {
+    d = tmp[VEC_GET(*l, i)];
+    if (d != INFTY) {
+      d += VEC_GET(*l, i+1);
+      if (d < min)
+        min = d;
+    }
+  }
+  return min;
+}
+
+/**
+ * Dijkstra from the hub of rank r at node s, forward over the arcs out
+ * of the nodes or backward over the arcs into them. A node is labeled
+ * with r and its distance unless the labels of lower rank already give
+ * a path as short, and then the search is pruned at the node. tmp has
+ * the opposite label of s, indexed by rank.
+ */
+static void pruned_search(const struct csr_graph *g, long r, long s, bool forward,
+                          VEC(long) *label, const long *tmp, long *dist,
+                          VEC(long) *touched, struct dist_heap *h)
+{
+  long k, d, u, v, end;
+  const long *offset, *next, *cost;
+
+  if (forward) {
+    offset = g->out_offset;
+    next = g->out_to;
+    cost = g->out_cost;
+  } else {
+    offset = g->in_offset;
+    next = g->in_from;
+    cost = g->in_cost;
+  }
+  h->size = 0;
+  dist[s] = 0;
+  VEC_PUSH(long, *touched, s);
+  heap_push(h, 0, s);
+  while (h->size > 0) {
+    heap_pop(h, &d, &u);
+    if (d > dist[u])
+      continue;
+    if (label_query(tmp, &label[u]) <= d)
+      continue;
+    VEC_PUSH(long, label[u], r);
+    VEC_PUSH(long, label[u], d);
+    end = offset[u+1];
+    for (k = offset[u]; k < end; k++) {
+      v = next[k];
+      if (d + cost[k] < dist[v]) {
+        if (dist[v] == INFTY)
+          VEC_PUSH(long, *touched, v);
+        dist[v] = d + cost[k];
+        heap_push(h, dist[v], v);
+      }
+    }
+  }
+  while (!VEC_EMPTY(*touched)) {
+    dist[VEC_POP(*touched)] = INFTY;
+  }
+}
+
+static inline void load_label(long *tmp, const VEC(long) *l)
+{
+  long i;
+
+  for (i = 0; i < (long)VEC_SIZE(*l); i += 2) {
+    tmp[VEC_GET(*l, i)] = VEC_GET(*l, i+1);
+  }
+}
+
+static inline void unload_label(long *tmp, const VEC(long) *l)
+{
+  long i;
+
+  for (i = 0; i < (long)VEC_SIZE(*l); i += 2) {
+    tmp[VEC_GET(*l, i)] = INFTY;
+  }
+}
+
+/**
+ * Copy the labels of the construction to the arrays of the index
+ */
+static void pack_labels(long n, VEC(long) *label, long **offset, int32_t **hub,
+                        long **dist)
+{
+  long v, i, m;
+
+  *offset = (long *)xmalloc((n + 1)*sizeof(long));
+  m = 0;
+  for (v = 0; v < n; v++) {
+    (*offset)[v] = m;
+    m += VEC_SIZE(label[v])/2;
+  }
+  (*offset)[n] = m;
+  *hub = (int32_t *)xmalloc((m + 1)*sizeof(int32_t));
+  *dist = (long *)xmalloc((m + 1)*sizeof(long));
+  for (v = 0; v < n; v++) {
+    m = (*offset)[v];
+    for (i = 0; i < (long)VEC_SIZE(label[v]); i += 2) {
+      (*hub)[m] = (int32_t)VEC_GET(label[v], i);
+      (*dist)[m] = VEC_GET(label[v], i+1);
+      m++;
+    }
+    VEC_DESTROY(label[v]);
+  }
+}
+
+/**
+ * Pruned landmark labeling of g. The hubs are taken by decreasing product
+ * of the in and out degrees, and then by increasing depth, so the nodes
+ * that are in most of the shortest paths get the lowest ranks and prune
+ * the searches of the later hubs.
+ */
+void build_hop_labels(struct hop_labels *hl, const struct csr_graph *g,
+                      const long *depth)
+{
+  long n, r, v;
+  long *tmp, *dist;
+  struct rank_key *keys;
+  struct label_build lb;
+  struct dist_heap h;
+  VEC(long) touched;
+
+  n = g->n_nodes;
+  hl->n_nodes = n;
+  if (n > INT32_MAX)
+    fatal("Error, too many nodes for the distance labels");
+  keys = (struct rank_key *)xmalloc((n + 1)*sizeof(struct rank_key));
+  for (v = 0; v < n; v++) {
+    keys[v].degree = (g->in_offset[v+1] - g->in_offset[v] + 1)*
+      (g->out_offset[v+1] - g->out_offset[v] + 1);
+    keys[v].depth = depth[v];
+    keys[v].node = v;
+  }
+  qsort(keys, n, sizeof(struct rank_key), rank_cmp);
+  hl->hub_node = (long *)xmalloc((n + 1)*sizeof(long));
+  for (r = 0; r < n; r++) {
+    hl->hub_node[r] = keys[r].node;
+  }
+  free(keys);
+
+  lb.out = (VEC(long) *)xmalloc((n + 1)*sizeof(VEC(long)));
+  lb.in = (VEC(long) *)xmalloc((n + 1)*sizeof(VEC(long)));
+  tmp = (long *)xmalloc((n + 1)*sizeof(long));
+  dist = (long *)xmalloc((n + 1)*sizeof(long));
+  for (v = 0; v < n; v++) {
+    VEC_INIT_N(long, lb.out[v], 2);
+    VEC_INIT_N(long, lb.in[v], 2);
+    tmp[v] = INFTY;
+    dist[v] = INFTY;
+  }
+  h.size = 0;
+  h.key = (long *)xmalloc((g->n_edges + n + 1)*sizeof(long));
+  h.node = (long *)xmalloc((g->n_edges + n + 1)*sizeof(long));
+  VEC_INIT(long, touched);
+
+  for (r = 0; r < n; r++) {
+    v = hl->hub_node[r];
+    load_label(tmp, &lb.out[v]);
+    pruned_search(g, r, v, true, lb.in, tmp, dist, &touched, &h);
+    unload_label(tmp, &lb.out[v]);
+    load_label(tmp, &lb.in[v]);
+    pruned_search(g, r, v, false, lb.out, tmp, dist, &touched, &h);
+    unload_label(tmp, &lb.in[v]);
+  }
+
+  pack_labels(n, lb.out, &hl->out_offset, &hl->out_hub, &hl->out_dist);
+  pack_labels(n, lb.in, &hl->in_offset, &hl->in_hub, &hl->in_dist);
+  VEC_DESTROY(touched);
+  free(h.key);
+  free(h.node);
+  free(lb.out);
+  free(lb.in);
+  free(tmp);
+  free(dist);
+}
+
+/**
+ * Length of the shortest path from s to t, or INFTY if there is no
+ * path, by a merge of the out label of s and the in label of t
+ */
+long hop_distance(const struct hop_labels *hl, long s, long t)
+{
+  long i, j, ei, ej, d, min;
+
+  min = INFTY;
+  i = hl->out_offset[s];
+  ei = hl->out_offset[s+1];
+  j = hl->in_offset[t];
+  ej = hl->in_offset[t+1];
+  while ((i < ei) && (j < ej)) {
+    if (hl->out_hub[i] < hl->in_hub[j]) {
+      i++;
+    } else if (hl->out_hub[i] > hl->in_hub[j]) {
+      j++;
+    } else {
+      d = hl->out_dist[i] + hl->in_dist[j];
+      if (d < min)
+        min = d;
+      i++;
+      j++;
+    }
+  }
+  return min;
+}
+
+/**
+ * Number of entries of all the labels
+ */
+long hop_labels_size(const struct hop_labels *hl)
+{
+  return hl->out_offset[hl->n_nodes] + hl->in_offset[hl->n_nodes];
+}
+
+void free_hop_labels(struct hop_labels *hl)
+{
+  free(hl->hub_node);
+  free(hl->out_offset);
+  free(hl->out_hub);
+  free(hl->out_dist);
+  free(hl->in_offset);
+  free(hl->in_hub);
+  free(hl->in_dist);
+  hl->n_nodes = 0;
+}
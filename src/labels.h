@@ -0,0 +1,42 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Exact distances of a DAG by pruned 2-hop labels
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___LABELS_H
+#define ___LABELS_H
+
+#include <stdint.h>
+
+/**
+ * The hubs are the nodes numbered by their rank in the order of the
+ * construction, hub_node[r] is the node of rank r. The entries
+ * [out_offset[v], out_offset[v+1]) are the hubs reachable from v with
+ * their distances, and [in_offset[v], in_offset[v+1]) the hubs that
+ * reach v. Both lists are sorted by rank, and every shortest path from
+ * s to t has a hub of the out label of s and of the in label of t.
+ */
+struct hop_labels {
+  long n_nodes;
+  long *hub_node;
+  long *out_offset;
+  int32_t *out_hub;
+  long *out_dist;
+  long *in_offset;
+  int32_t *in_hub;
+  long *in_dist;
+};
+
+void build_hop_labels(struct hop_labels *hl, const struct csr_graph *g,
+                      const long *depth);
+
+long hop_distance(const struct hop_labels *hl, long s, long t);
+
+long hop_labels_size(const struct hop_labels *hl);
+
+void free_hop_labels(struct hop_labels *hl);
+
+#endif /* ___LABELS_H */
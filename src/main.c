@@ -12,11 +12,13 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <stdint.h>
 
 #include "types.h"
 #include "memory.h"
 #include "graph.h"
 #include "util.h"
+#include "arena.h"
 #include "input.h"
 #include "tax_sim.h"
 
@@ -28,13 +30,18 @@ struct global_args {
      char *desc_filename;
      char *annt_filename;
      unsigned n_threads;
+     uint64_t chunk_size;
      enum metric d;
+     enum lca_engine engine;
+     bool batch;
+     bool rows;
+     bool labels;
      bool description;
      bool lca; 
 };
 
 static struct global_args g_args;
-static const char *optString = "ldm:t:";
+static const char *optString = "ldbrim:t:c:e:";
 
 /*********************************
  **  Parse Arguments
@@ -42,7 +49,7 @@ static const char *optString = "ldm:t:";
 
 static void display_usage(void)
 {
-     fatal("Incorrect arguments \n\ttaxsim [-m tax|str|ps] [-t <number of threads>] [-d] [-l] <graph> <terms> <annotations>\n");
+     fatal("Incorrect arguments \n\ttaxsim [-m tax|str|ps] [-t <number of threads>] [-c <pairs per chunk>] [-e merge|bitset|packed|tree] [-b] [-r] [-i] [-d] [-l] <graph> <terms> <annotations>\n");
 }
 
 static void initialize_arguments(void)
@@ -51,8 +58,13 @@ static void initialize_arguments(void)
      g_args.desc_filename = NULL;
      g_args.annt_filename = NULL;
      g_args.d = DTAX;
+     g_args.engine = LCA_MERGE;
      g_args.n_threads = 1;
+     g_args.chunk_size = DEFAULT_CHUNK_SIZE;
      g_args.description = false;
+     g_args.batch = false;
+     g_args.rows = false;
+     g_args.labels = false;
      g_args.lca = false;
 }
 
@@ -69,10 +81,20 @@ static void print_args(void)
      } else {
 	  fatal("Unknown metric");
      }
+     if (g_args.engine == LCA_MERGE) {
+	  printf("LCA engine: merge\n");
+     } else if (g_args.engine == LCA_BITSET) {
+	  printf("LCA engine: bitset\n");
+     } else if (g_args.engine == LCA_PACKED) {
+	  printf("LCA engine: packed\n");
+     } else {
+	  printf("LCA engine: tree\n");
+     }
      printf("Graph: %s\n", g_args.graph_filename);
      printf("Terms description: %s\n", g_args.desc_filename);
      printf("Annotations: %s\n", g_args.annt_filename);
      printf("Number of Threads: %d\n", g_args.n_threads);
+     printf("Pairs per chunk: %lu\n", (unsigned long)g_args.chunk_size);
      printf("*********************\n");
 }
 
@@ -91,6 +113,15 @@ static void parse_args(int argc, char **argv)
 	  case 'd':
 	       g_args.description = true;
 	       break;
+	  case 'b':
+	       g_args.batch = true;
+	       break;
+	  case 'r':
+	       g_args.rows = true;
+	       break;
+	  case 'i':
+	       g_args.labels = true;
+	       break;
 	  case 'm':
 	       if (strcmp(optarg, "tax") == 0) {
 		    g_args.d = DTAX;
@@ -110,6 +141,24 @@ static void parse_args(int argc, char **argv)
 	       if (MAX_THREADS < g_args.n_threads)
 		    fatal("Error, The maximum number of threads allowed is %d", MAX_THREADS);
 	       break;
+	  case 'e':
+	       if (strcmp(optarg, "merge") == 0) {
+		    g_args.engine = LCA_MERGE;
+	       } else if (strcmp(optarg, "bitset") == 0) {
+		    g_args.engine = LCA_BITSET;
+	       } else if (strcmp(optarg, "packed") == 0) {
+		    g_args.engine = LCA_PACKED;
+	       } else if (strcmp(optarg, "tree") == 0) {
+		    g_args.engine = LCA_TREE;
+	       } else {
+		    display_usage();
+	       }
+	       break;
+	  case 'c':
+	       if (strtol(optarg, (char **)NULL, 10) < 1)
+		    fatal("Error, The minimum number of pairs per chunk is 1");
+	       g_args.chunk_size = strtol(optarg, (char **)NULL, 10);
+	       break;
 	  case '?':
 	       display_usage();
 	       break;
@@ -119,6 +168,14 @@ static void parse_args(int argc, char **argv)
 	  }
 	  opt = getopt(argc, argv, optString);
      }
+     if (g_args.batch && (g_args.engine == LCA_PACKED))
+	  fatal("Error, the batch LCA needs the lists of ancestors of the engine merge, bitset or tree");
+     if (g_args.rows && (g_args.engine == LCA_PACKED))
+	  fatal("Error, the row LCA needs the lists of ancestors of the engine merge, bitset or tree");
+     if (g_args.batch && g_args.rows)
+	  fatal("Error, the options -b and -r can not be used together");
+     if (g_args.labels && (g_args.batch || g_args.rows))
+	  fatal("Error, the option -i can not be used with -b or -r");
      if ((argc - optind) != MIN_ARG)
 	  display_usage();
      i = optind;
@@ -139,6 +196,7 @@ int main(int argc, char **argv)
 {
      clock_t ti, tf;
      struct input_data in;
+     struct sim_options opt;
 
      ti = clock();     
      parse_args(argc, argv);
@@ -149,11 +207,17 @@ int main(int argc, char **argv)
      in = get_input_ontology_data(g_args.graph_filename,
 				  g_args.desc_filename,
 				  g_args.annt_filename, 
-				  g_args.description);
-     taxonomic_similarity(&in.g, &in.anntt,
-			  g_args.n_threads,
-			  in.descriptions,
-			  g_args.d, g_args.lca);
+				  g_args.description,
+				  g_args.n_threads);
+     opt.n_threads = g_args.n_threads;
+     opt.chunk_size = g_args.chunk_size;
+     opt.d = g_args.d;
+     opt.engine = g_args.engine;
+     opt.batch = g_args.batch;
+     opt.rows = g_args.rows;
+     opt.labels = g_args.labels;
+     opt.print_lca = g_args.lca;
+     taxonomic_similarity(&in.g, &in.anntt, &in.strings, in.descriptions, &opt);
      tf = clock();
      free_input_data(&in);
      printf("\nTotal Time %.3f secs\n", (double)(tf-ti)/CLOCKS_PER_SEC);
@@ -5,12 +5,15 @@
  * @author Guillermo Palma <gpalma@ldc.usb.ve>
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <assert.h>
 #include <limits.h>
 #include <math.h>
+#include <sched.h>
+#include <time.h>
 
 #include "dlist.h"
 #include "types.h"
@@ -18,31 +21,81 @@
 #include "memory.h"
 #include "graph.h"
 #include "CA.h"
+#include "closure.h"
+#include "pack.h"
+#include "tree_lca.h"
+#include "labels.h"
 #include "metric.h"
 
 #define ROOT  0
 
+/* States of an entry of the ancestor cache */
+#define ANC_EMPTY     0
+#define ANC_BUILDING  1
+#define ANC_READY     2
+
 static long n;
-static bool *visited;
-static VEC(long) **ancestors;
+static char *anc_state;
+static struct ancestors **ancestors;
+static struct packed_ancestors **packed;
 static long *depth;
-static struct graph gi;
+static long *root_dist;
+static struct csr_graph gi;
 static bool init_metric = false;
 static long max_depth;
+static enum lca_engine engine;
+static struct closure anc_closure;
+static bool has_closure = false;
+static struct tree_lca tl;
+static struct hop_labels hl;
+static bool has_labels = false;
 
-void init_metric_data(const struct graph *g)
+/**
+ * e is the algorithm used for the LCA. With LCA_BITSET the bit rows are
+ * built for the terms given later to precompute_ancestors, with
+ * LCA_PACKED all the cached lists of ancestors are compressed, and with
+ * LCA_TREE the LCA of the nodes with a single path to the root is found
+ * in the euler tour. With labels, the 2-hop labels of the graph give
+ * the distances from the LCA of every engine, and the shortest path
+ * queries of the graph, min_distance and min_path, on g.
+ */
+void init_metric_data(const struct csr_graph *g, enum lca_engine e, bool labels)
 {
-  depth = calculate_depth(g);
-  DEBUG("\n** Depth node calculation done ** \n");
+  clock_t ti;
+
   n = g->n_nodes;
-  ancestors = xmalloc(n*sizeof(VEC(long)));
-  graph_inverse(g, &gi);
-  DEBUG("\n** Graph inverse done ** \n");
-  visited = xcalloc(n, sizeof(bool));
+  depth = (long *)xmalloc(n*sizeof(long));
+  root_dist = (long *)xmalloc(n*sizeof(long));
+  calculate_root_distances(g, root_dist, depth);
+  DEBUG("\n** Depth node calculation done ** \n");
+  ancestors = xmalloc(n*sizeof(struct ancestors *));
+  packed = xmalloc(n*sizeof(struct packed_ancestors *));
+  csr_reverse(g, &gi);
+  anc_state = xcalloc(n, sizeof(char));
   max_depth = INT_MAX;
+  engine = e;
+  has_closure = false;
+  if (engine == LCA_TREE)
+    build_tree_lca(&tl, g);
+  has_labels = labels;
+  if (has_labels) {
+    ti = clock();
+    build_hop_labels(&hl, g, depth);
+    set_distance_labels(g, &hl);
+    printf("Distance labels: %ld entries, %.2f MB, built in %.3f secs\n",
+           hop_labels_size(&hl),
+           (double)hop_labels_size(&hl)*(sizeof(int32_t) + sizeof(long))/(1024*1024),
+           (double)(clock() - ti)/CLOCKS_PER_SEC);
+  }
   init_metric = true;
 }
 
+static inline void check_metric_data(const struct csr_graph *g)
+{
+  if (!init_metric || g->n_nodes != n)
+    fatal("Error, uninitialized data for metric calcule");
+}
+
 static inline double dtax(long dax, long day, long drx, long dry)
 {
   /*     fprintf(stderr, "\n dtax %ld %ld %ld %ld\n", dax, day, drx, dry);*/
@@ -51,61 +104,239 @@ static inline double dtax(long dax, long day, long drx, long dry)
   return MIN(r, 1.0);
 }
 
-static VEC(long) *get_list_ancestors(long node)
+struct precompute_args {
+  const long *terms;
+  long n_terms;
+  long *next;
+};
+
+/**
+ * Build the cached ancestors of node on the first use. The entry is
+ * published once: the thread that moves the state from ANC_EMPTY to
+ * ANC_BUILDING builds the list, and any other thread that asks for the
+ * same node waits only until that entry becomes ANC_READY. The list is
+ * built with the buffers of ws when it is not NULL, and it is kept in
+ * packed instead of ancestors with the LCA_PACKED engine.
+ */
+static void cache_ancestors(long node, struct ancestors_ws *ws)
+{
+  struct ancestors *la;
+  char expected;
+
+  if (__atomic_load_n(&anc_state[node], __ATOMIC_ACQUIRE) == ANC_READY)
+    return;
+
+  expected = ANC_EMPTY;
+  if (__atomic_compare_exchange_n(&anc_state[node], &expected, ANC_BUILDING, false,
+                                  __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+    if (ws)
+      la = get_ancestors_ws(&gi, node, ws);
+    else
+      la = get_ancestors(&gi, node);
+    if (engine == LCA_PACKED) {
+      packed[node] = pack_ancestors(la);
+      free_ancestors(la);
+    } else {
+      ancestors[node] = la;
+    }
+    __atomic_store_n(&anc_state[node], ANC_READY, __ATOMIC_RELEASE);
+    return;
+  }
+  while (__atomic_load_n(&anc_state[node], __ATOMIC_ACQUIRE) != ANC_READY)
+    sched_yield();
+}
+
+static inline struct ancestors *get_list_ancestors(long node)
 {
-  VEC(long) *la;
+  cache_ancestors(node, NULL);
+  return ancestors[node];
+}
 
-  if (!visited[node]) {
-    la = get_ancestors(&gi, node);
-    ancestors[node] = la;
-    visited[node] = true;
-  } else {
-    la = ancestors[node];
+/**
+ * The list of ancestors of node, built if it is not cached. The lists
+ * are not kept with the LCA_PACKED engine.
+ */
+const struct ancestors *metric_ancestors(long node)
+{
+  if (!init_metric || (engine == LCA_PACKED))
+    fatal("Error, the lists of ancestors are not available");
+  return get_list_ancestors(node);
+}
+
+static inline struct packed_ancestors *get_packed_ancestors(long node)
+{
+  cache_ancestors(node, NULL);
+  return packed[node];
+}
+
+static void *precompute_worker(void *args)
+{
+  struct precompute_args *pa;
+  struct ancestors_ws ws;
+  long i;
+
+  pa = (struct precompute_args *)args;
+  init_ancestors_ws(&ws, n);
+  i = __atomic_fetch_add(pa->next, 1, __ATOMIC_RELAXED);
+  while (i < pa->n_terms) {
+    cache_ancestors(pa->terms[i], &ws);
+    i = __atomic_fetch_add(pa->next, 1, __ATOMIC_RELAXED);
   }
+  free_ancestors_ws(&ws);
 
-  return la;
+  return NULL;
 }
 
-double dist_tax(const struct graph *g, long x, long y)
+/**
+ * Build the ancestors of the distinct terms of v before the metrics are
+ * computed. The terms are handed out one at a time to n_threads threads,
+ * and each thread reuses its own workspace for all its searches. After
+ * this call the metrics only read the cache for these terms. With
+ * LCA_TREE the lists are skipped only when every term is a tree node,
+ * since a pair with a node out of the tree needs the lists of both,
+ * and all_lists asks for them anyway, as the batch LCA and the row
+ * sweep do.
+ */
+void precompute_ancestors(const VEC(long) *v, unsigned n_threads, bool all_lists)
 {
-  long lca, dax, day, drx, dry;
-  VEC(long) *lx, *ly;
+  pthread_t thread[MAX(n_threads, 1U)];
+  struct precompute_args args;
+  VEC(long) terms;
+  bool *seen, all_tree;
+  long i, node, next;
+  unsigned t;
+  int tc;
 
   if (!init_metric)
     fatal("Error, uninitialized data for metric calcule");
 
+  seen = xcalloc(n, sizeof(bool));
+  VEC_INIT(long, terms);
+  all_tree = (engine == LCA_TREE);
+  for (i = 0; i < (long)VEC_SIZE(*v); i++) {
+    node = VEC_GET(*v, i);
+    if (!seen[node]) {
+      seen[node] = true;
+      if (all_tree && !in_tree(&tl, node))
+        all_tree = false;
+      VEC_PUSH(long, terms, node);
+    }
+  }
+  free(seen);
+  if (all_tree && !all_lists)
+    VEC_CLEAR(terms);
+
+  /* No terms to build leaves only the main thread */
+  if ((long)n_threads > (long)VEC_SIZE(terms))
+    n_threads = VEC_SIZE(terms);
+  if (n_threads == 0)
+    n_threads = 1;
+  next = 0;
+  args.terms = terms.data;
+  args.n_terms = VEC_SIZE(terms);
+  args.next = &next;
+  for (t = 1; t < n_threads; t++) {
+    tc = pthread_create(&thread[t], NULL, precompute_worker, (void *)&args);
+    if (tc)
+      fatal("ERROR; return code from pthread_create() is %d\n", tc);
+  }
+  precompute_worker((void *)&args);
+  for (t = 1; t < n_threads; t++) {
+    tc = pthread_join(thread[t], NULL);
+    if (tc)
+      fatal("ERROR; return code from pthread_join() is %d\n", tc);
+  }
+  if (engine == LCA_BITSET) {
+    build_closure(&anc_closure, ancestors, terms.data, VEC_SIZE(terms), depth, n);
+    has_closure = true;
+    DEBUG("\n** Closure of %ld terms with %ld columns done ** \n",
+          anc_closure.n_rows, anc_closure.n_cols);
+  }
+  VEC_DESTROY(terms);
+  DEBUG("\n** Ancestors of %ld terms done ** \n", args.n_terms);
+}
+
+/**
+ * The LCA of x and y, with the distances from it to x and y. The bit
+ * rows are used when both terms have one, and the euler tour when both
+ * terms are in the tree. In the tree the distances are the differences
+ * of the distances from the root, since there is one path. With the
+ * 2-hop labels, the distances of the bit rows are left to the caller,
+ * so the lists of the terms are not needed.
+ */
+static inline long engine_lca(long x, long y, long *dax, long *day)
+{
+  long lca;
+  struct ancestors *lx, *ly;
+
+  if (engine == LCA_PACKED)
+    return packed_lca(get_packed_ancestors(x), get_packed_ancestors(y),
+                      depth, dax, day, NULL);
+  if ((engine == LCA_TREE) && in_tree(&tl, x) && in_tree(&tl, y)) {
+    lca = tree_lca_query(&tl, x, y);
+    *dax = root_dist[x] - root_dist[lca];
+    *day = root_dist[y] - root_dist[lca];
+    return lca;
+  }
+  if (has_closure) {
+    lca = closure_lca(&anc_closure, x, y);
+    if ((lca != -1) && has_labels)
+      return lca;
+    if (lca != -1) {
+      *dax = ancestor_dist(get_list_ancestors(x), lca);
+      *day = ancestor_dist(get_list_ancestors(y), lca);
+      return lca;
+    }
+  }
   lx = get_list_ancestors(x);
   ly = get_list_ancestors(y);
-  lca = LCA_CA(lx, ly, depth);
-  dax = min_distance(g, lca, x);
-  day = min_distance(g, lca, y);
-  drx = min_distance(g, ROOT, x);
-  dry = min_distance(g, ROOT, y);
+  return LCA_CA(lx, ly, depth, dax, day);
+}
+
+/**
+ * The LCA of x and y given by the engine. With the 2-hop labels, the
+ * distances from it to x and y are always taken from the labels.
+ */
+static inline long lowest_common_ancestor(long x, long y, long *dax, long *day)
+{
+  long lca;
+
+  lca = engine_lca(x, y, dax, day);
+  if (has_labels) {
+    *dax = hop_distance(&hl, lca, x);
+    *day = hop_distance(&hl, lca, y);
+  }
+  return lca;
+}
+
+double dist_tax(const struct csr_graph *g, long x, long y)
+{
+  long dax, day, drx, dry;
+
+  check_metric_data(g);
+
+  lowest_common_ancestor(x, y, &dax, &day);
+  drx = root_dist[x];
+  dry = root_dist[y];
 
   return dtax(dax, day, drx, dry);
 }
 
-double dist_tax_lca(const struct graph *g, long x, long y, long *lcap)
+double dist_tax_lca(const struct csr_graph *g, long x, long y, long *lcap)
 {
   long lca, dax, day, drx, dry;
-  VEC(long) *lx, *ly;
 
-  if (!init_metric)
-    fatal("Error, uninitialized data for metric calcule");
+  check_metric_data(g);
 
-  lx = get_list_ancestors(x);
-  ly = get_list_ancestors(y);
-  lca = LCA_CA(lx, ly, depth);
+  lca = lowest_common_ancestor(x, y, &dax, &day);
   *lcap = lca;
-  dax = min_distance(g, lca, x);
-  day = min_distance(g, lca, y);
-  drx = min_distance(g, ROOT, x);
-  dry = min_distance(g, ROOT, y);
+  drx = root_dist[x];
+  dry = root_dist[y];
 
   return dtax(dax, day, drx, dry);
 }
 
-double sim_dtax(const struct graph *g, long x, long y)
+double sim_dtax(const struct csr_graph *g, long x, long y)
 {
   return (1.0 - dist_tax(g, x, y));
 }
@@ -115,62 +346,80 @@ static inline double dps(long dax, long day, long dra)
   return (1.0 - ((double)dra/(dax + day + dra)));
 }
 
-double dist_ps(const struct graph *g, long x, long y)
+double dist_ps(const struct csr_graph *g, long x, long y)
 {
   long lca, dax, day, dra;
-  VEC(long) *lx, *ly;
 
-  if (!init_metric)
-    fatal("Error, uninitialized data for metric calcule");
+  check_metric_data(g);
 
-  lx = get_list_ancestors(x);
-  ly = get_list_ancestors(y);
-  lca = LCA_CA(lx, ly, depth);
-  dax = min_distance(g, lca, x);
-  day = min_distance(g, lca, y);
-  dra = max_distance(g, ROOT, lca);
+  lca = lowest_common_ancestor(x, y, &dax, &day);
+  dra = depth[lca];
 
   return dps(dax, day, dra);
 }
 
-double dist_ps_lca(const struct graph *g, long x, long y, long *lcap)
+double dist_ps_lca(const struct csr_graph *g, long x, long y, long *lcap)
 {
   long lca, dax, day, dra;
-  VEC(long) *lx, *ly;
 
-  if (!init_metric)
-    fatal("Error, uninitialized data for metric calcule");
+  check_metric_data(g);
 
-  lx = get_list_ancestors(x);
-  ly = get_list_ancestors(y);
-  lca = LCA_CA(lx, ly, depth);
+  lca = lowest_common_ancestor(x, y, &dax, &day);
   *lcap = lca;
-  dax = min_distance(g, lca, x);
-  day = min_distance(g, lca, y);
-  dra = max_distance(g, ROOT, lca);
+  dra = depth[lca];
 
   return dps(dax, day, dra);
 }
 
-double sim_dps(const struct graph *g, long x, long y)
+double sim_dps(const struct csr_graph *g, long x, long y)
 {
   return (1.0 - dist_ps(g, x, y));
 }
 
+/**
+ * Similarities of x and y when their LCA and the distances from it to
+ * x and y are already known
+ */
+double sim_dtax_known(long x, long y, long lca, long dax, long day)
+{
+  (void)lca;
+  return (1.0 - dtax(dax, day, root_dist[x], root_dist[y]));
+}
+
+double sim_dps_known(long x, long y, long lca, long dax, long day)
+{
+  (void)x;
+  (void)y;
+  return (1.0 - dps(dax, day, depth[lca]));
+}
+
 void free_metric(void)
 {
   long i;
 
   for (i = 0; i < n; i++) {
-    if (visited[i]) {
-      VEC_DESTROY(*ancestors[i]);
-      free(ancestors[i]);
-    }
+    if (anc_state[i] != ANC_READY)
+      continue;
+    if (engine == LCA_PACKED)
+      free_packed_ancestors(packed[i]);
+    else
+      free_ancestors(ancestors[i]);
   }
+  if (has_closure)
+    free_closure(&anc_closure);
+  has_closure = false;
+  if (engine == LCA_TREE)
+    free_tree_lca(&tl);
+  if (has_labels) {
+    set_distance_labels(NULL, NULL);
+    free_hop_labels(&hl);
+  }
+  has_labels = false;
   free(ancestors);
+  free(packed);
   free(depth);
-  free(visited);
-  free_graph(&gi);
+  free(root_dist);
+  free(anc_state);
 }
 
 static inline double decresing_factor(long node_depth, long max_depth)
@@ -183,7 +432,7 @@ void set_max_depth(long new_depth)
   max_depth = new_depth;
 }
 
-double sim_str(const struct graph *g, long x, long y)
+double sim_str(const struct csr_graph *g, long x, long y)
 {
   double dfx, dfy;
   double sim;
@@ -198,7 +447,22 @@ double sim_str(const struct graph *g, long x, long y)
   return sim;
 }
 
-double dist_str(const struct graph *g, long x, long y)
+double sim_str_known(long x, long y, long lca, long dax, long day)
+{
+  double dfx, dfy;
+  double sim;
+
+  if (x == y) {
+       sim  = sim_dtax_known(x, y, lca, dax, day);
+  } else {
+       dfx = decresing_factor(depth[x], max_depth);
+       dfy = decresing_factor(depth[y], max_depth);
+       sim  = sim_dtax_known(x, y, lca, dax, day) * (1.0 - MAX(dfx, dfy));
+  }
+  return sim;
+}
+
+double dist_str(const struct csr_graph *g, long x, long y)
 {
   return  (1.0 - sim_str(g, x, y));
 }
@@ -210,13 +474,33 @@ const long *get_nodes_depth(void)
 
 VEC(long) *lca_vector(long x, long y)
 {
-  VEC(long) *lx, *ly;
+  struct ancestors *lx, *ly;
+  VEC(long) *lca;
+  long dax, day;
 
   if (!init_metric)
     fatal("Error, uninitialized data for metric calcule");
 
+  if (engine == LCA_PACKED) {
+    lca = (VEC(long) *)xmalloc(sizeof(VEC(long)));
+    VEC_INIT(long, *lca);
+    packed_lca(get_packed_ancestors(x), get_packed_ancestors(y), depth, &dax, &day, lca);
+    return lca;
+  }
+  if ((engine == LCA_TREE) && in_tree(&tl, x) && in_tree(&tl, y)) {
+    lca = (VEC(long) *)xmalloc(sizeof(VEC(long)));
+    VEC_INIT(long, *lca);
+    VEC_PUSH(long, *lca, tree_lca_query(&tl, x, y));
+    return lca;
+  }
+  if (has_closure && (anc_closure.row[x] != -1) && (anc_closure.row[y] != -1)) {
+    lca = (VEC(long) *)xmalloc(sizeof(VEC(long)));
+    VEC_INIT(long, *lca);
+    closure_lca_set(&anc_closure, x, y, depth, lca);
+    return lca;
+  }
   lx = get_list_ancestors(x);
   ly = get_list_ancestors(y);
 
-  return LCA_CA_SET(lx, ly, depth);
+  return LCA_CA_SET(lx, ly, depth, NULL, NULL, NULL);
 }
@@ -8,25 +8,35 @@
 #ifndef ___METRIC_H
 #define ___METRIC_H
 
-void init_metric_data(const struct graph *g);
+void init_metric_data(const struct csr_graph *g, enum lca_engine e, bool labels);
 
-double dist_tax(const struct graph *g, long term1, long term2);
+void precompute_ancestors(const VEC(long) *v, unsigned n_threads, bool all_lists);
 
-double sim_dtax(const struct graph *g, long x, long y);
+double dist_tax(const struct csr_graph *g, long term1, long term2);
 
-double dist_tax_lca(const struct graph *g, long x, long y, long *lcap);
+double sim_dtax(const struct csr_graph *g, long x, long y);
 
-double dist_ps(const struct graph *g, long x, long y);
+double dist_tax_lca(const struct csr_graph *g, long x, long y, long *lcap);
 
-double sim_dps(const struct graph *g, long x, long y);
+double dist_ps(const struct csr_graph *g, long x, long y);
 
-double dist_ps_lca(const struct graph *g, long x, long y, long *lcap);
+double sim_dps(const struct csr_graph *g, long x, long y);
+
+double dist_ps_lca(const struct csr_graph *g, long x, long y, long *lcap);
 
 void set_max_depth(long new_depth);
 
-double sim_str(const struct graph *g, long x, long y);
+double sim_str(const struct csr_graph *g, long x, long y);
+
+double dist_str(const struct csr_graph *g, long x, long y);
+
+double sim_dtax_known(long x, long y, long lca, long dax, long day);
+
+double sim_dps_known(long x, long y, long lca, long dax, long day);
+
+double sim_str_known(long x, long y, long lca, long dax, long day);
 
-double dist_str(const struct graph *g, long x, long y);
+const struct ancestors *metric_ancestors(long node);
 
 void free_metric(void);
 
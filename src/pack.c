@@ -0,0 +1,212 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Compressed lists of ancestors
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "CA.h"
+#include "pack.h"
+
+/* A varint of a 64 bits value takes at most 10 bytes */
+#define VARINT_MAX  10
+
+/**
+ * Position in a packed list: the entry i, with its id and distance, and
+ * the offset of the next entry.
+ */
+struct pack_cursor {
+     const struct packed_ancestors *p;
+     long i;
+     long off;
+     long id;
+     long dist;
+};
+
+static inline long put_varint(uint8_t *buf, unsigned long v)
+{
+     long n;
+
+     n = 0;
+     while (v >= 0x80) {
+	  buf[n++] = (uint8_t)(v | 0x80);
+	  v >>= 7;
+     }
+     buf[n++] = (uint8_t)v;
+     return n;
+}
+
+static inline unsigned long get_varint(const uint8_t *buf, long *off)
+{
+     unsigned long v;
+     int shift;
+     uint8_t b;
+
+     v = 0;
+     shift = 0;
+     do {
+	  b = buf[(*off)++];
+	  v |= (unsigned long)(b & 0x7f) << shift;
+	  shift += 7;
+     } while (b & 0x80);
+     return v;
+}
+
+/**
+ * Compress the list a. The result is one allocation.
+ */
+struct packed_ancestors *pack_ancestors(const struct ancestors *a)
+{
+     long i, n, len, prev, n_skip;
+     uint8_t *buf;
+     struct pack_skip *skip;
+     struct packed_ancestors *p;
+     char *mem;
+
+     n = VEC_SIZE(a->node);
+     n_skip = (n + PACK_SKIP - 1)/PACK_SKIP;
+     skip = (struct pack_skip *)xmalloc((n_skip + 1)*sizeof(struct pack_skip));
+     buf = (uint8_t *)xmalloc(2*VARINT_MAX*n + 1);
+     len = 0;
+     prev = 0;
+     for (i = 0; i < n; i++) {
+	  if (i % PACK_SKIP == 0) {
+	       skip[i/PACK_SKIP].id = VEC_GET(a->node, i);
+	       skip[i/PACK_SKIP].off = len;
+	  }
+	  len += put_varint(buf + len, VEC_GET(a->node, i) - prev);
+	  len += put_varint(buf + len, VEC_GET(a->dist, i));
+	  prev = VEC_GET(a->node, i);
+     }
+
+     mem = (char *)xmalloc(sizeof(struct packed_ancestors)
+			   + n_skip*sizeof(struct pack_skip) + len);
+     p = (struct packed_ancestors *)mem;
+     p->size = n;
+     p->n_skip = n_skip;
+     p->skip = (struct pack_skip *)(mem + sizeof(struct packed_ancestors));
+     p->bytes = (uint8_t *)(p->skip + n_skip);
+     memcpy(p->skip, skip, n_skip*sizeof(struct pack_skip));
+     memcpy(p->bytes, buf, len);
+     free(skip);
+     free(buf);
+
+     return p;
+}
+
+void free_packed_ancestors(struct packed_ancestors *p)
+{
+     free(p);
+}
+
+/**
+ * Decode the entry i of the cursor, whose id before it is prev
+ */
+static inline void cursor_read(struct pack_cursor *c, long prev)
+{
+     c->id = prev + get_varint(c->p->bytes, &c->off);
+     c->dist = get_varint(c->p->bytes, &c->off);
+}
+
+static inline bool cursor_start(struct pack_cursor *c, const struct packed_ancestors *p)
+{
+     c->p = p;
+     c->i = 0;
+     c->off = 0;
+     if (p->size == 0)
+	  return false;
+     cursor_read(c, 0);
+     return true;
+}
+
+static inline bool cursor_next(struct pack_cursor *c)
+{
+     if (++c->i >= c->p->size)
+	  return false;
+     cursor_read(c, c->id);
+     return true;
+}
+
+/**
+ * Move the cursor to the first entry with id greater than or equal
+ * to v, jumping by the skip points first
+ */
+static inline bool cursor_seek(struct pack_cursor *c, long v)
+{
+     long b, nb;
+     const struct pack_skip *skip;
+
+     skip = c->p->skip;
+     b = c->i/PACK_SKIP;
+     nb = b;
+     while ((nb + 1 < c->p->n_skip) && (skip[nb + 1].id <= v))
+	  nb++;
+     if (nb != b) {
+	  c->i = nb*PACK_SKIP;
+	  c->off = skip[nb].off;
+	  get_varint(c->p->bytes, &c->off);
+	  c->id = skip[nb].id;
+	  c->dist = get_varint(c->p->bytes, &c->off);
+     }
+     while (c->id < v) {
+	  if (!cursor_next(c))
+	       return false;
+     }
+     return true;
+}
+
+/**
+ * The LCA of the terms of a and b, the deepest common ancestor with
+ * the smallest id, and its distances to them. The set of the deepest
+ * common ancestors is also given in set when it is not NULL. The lists
+ * are merged as they are decoded.
+ */
+long packed_lca(const struct packed_ancestors *a, const struct packed_ancestors *b,
+		const long *depth, long *dax, long *day, VEC(long) *set)
+{
+     struct pack_cursor ca, cb;
+     long max, lca;
+     bool more;
+
+     max = -1;
+     lca = -1;
+     if (set)
+	  VEC_CLEAR(*set);
+     more = cursor_start(&ca, a) && cursor_start(&cb, b);
+     while (more) {
+	  if (ca.id < cb.id) {
+	       more = cursor_seek(&ca, cb.id);
+	  } else if (cb.id < ca.id) {
+	       more = cursor_seek(&cb, ca.id);
+	  } else {
+	       if (depth[ca.id] > max) {
+		    max = depth[ca.id];
+		    lca = ca.id;
+		    *dax = ca.dist;
+		    *day = cb.dist;
+		    if (set) {
+			 VEC_CLEAR(*set);
+			 VEC_PUSH(long, *set, ca.id);
+		    }
+	       } else if (set && (depth[ca.id] == max)) {
+		    VEC_PUSH(long, *set, ca.id);
+	       }
+	       more = cursor_next(&ca) && cursor_next(&cb);
+	  }
+     }
+     if (lca == -1)
+	  fatal("Error with the lowest common ancestor");
+     return lca;
+}
@@ -0,0 +1,42 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Compressed lists of ancestors
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___PACK_H
+#define ___PACK_H
+
+#include <stdint.h>
+
+/* Entries between two skip points */
+#define PACK_SKIP  32
+
+struct pack_skip {
+     long id;
+     long off;
+};
+
+/**
+ * The ancestors of a node sorted by id, as varints of the difference
+ * with the previous id followed by varints of the distance. The skip
+ * points give the id and the offset of every PACK_SKIP-th entry, so an
+ * intersection can jump over the entries that are not needed.
+ */
+struct packed_ancestors {
+     long size;
+     long n_skip;
+     struct pack_skip *skip;
+     uint8_t *bytes;
+};
+
+struct packed_ancestors *pack_ancestors(const struct ancestors *a);
+
+void free_packed_ancestors(struct packed_ancestors *p);
+
+long packed_lca(const struct packed_ancestors *a, const struct packed_ancestors *b,
+		const long *depth, long *dax, long *day, VEC(long) *set);
+
+#endif /* ___PACK_H */
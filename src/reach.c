@@ -0,0 +1,206 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Reachability index of a DAG by tree cover intervals
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "reach.h"
+
+static int interval_cmp(const void *a, const void *b)
+{
+  const struct lpairs *ia = (const struct lpairs *)a;
+  const struct lpairs *ib = (const struct lpairs *)b;
+
+  return (ia->x > ib->x) - (ia->x < ib->x);
+}
+
+/**
+ * Postorder numbers of the spanning forest given by the arcs of st.
+ * The trees are visited from the nodes without a tree parent, in
+ * increasing order of id.
+ */
+static void number_forest(const struct csr_graph *g, const bool *st,
+                          struct reach_index *ri)
+{
+  long i, k, u, v, ctr;
+  bool *child;
+  long *next, *parent;
+
+  child = (bool *)xcalloc(g->n_nodes, sizeof(bool));
+  for (u = 0; u < g->n_nodes; u++) {
+    csr_for_each_out(k, g, u) {
+      if (st[g->out_id[k]])
+        child[g->out_to[k]] = true;
+    }
+  }
+  next = (long *)xmalloc(g->n_nodes*sizeof(long));
+  parent = (long *)xmalloc(g->n_nodes*sizeof(long));
+  ctr = 0;
+  for (i = 0; i < g->n_nodes; i++) {
+    if (child[i])
+      continue;
+    parent[i] = -1;
+    next[i] = g->out_offset[i];
+    ri->low[i] = ctr;
+    u = i;
+    while (u != -1) {
+      if (next[u] < g->out_offset[u+1]) {
+        k = next[u]++;
+        if (!st[g->out_id[k]])
+          continue;
+        v = g->out_to[k];
+        parent[v] = u;
+        next[v] = g->out_offset[v];
+        ri->low[v] = ctr;
+        u = v;
+      } else {
+        ri->post[u] = ctr++;
+        u = parent[u];
+      }
+    }
+  }
+  free(child);
+  free(next);
+  free(parent);
+}
+
+/**
+ * Nodes of g in topological order, by removing the nodes without
+ * incoming arcs
+ */
+static long *topological_order(const struct csr_graph *g)
+{
+  long i, k, u, v, head, tail;
+  long *indeg, *order;
+
+  indeg = (long *)xcalloc(g->n_nodes, sizeof(long));
+  order = (long *)xmalloc(g->n_nodes*sizeof(long));
+  for (k = 0; k < g->n_edges; k++) {
+    indeg[g->out_to[k]]++;
+  }
+  tail = 0;
+  for (i = 0; i < g->n_nodes; i++) {
+    if (indeg[i] == 0)
+      order[tail++] = i;
+  }
+  for (head = 0; head < tail; head++) {
+    u = order[head];
+    csr_for_each_out(k, g, u) {
+      v = g->out_to[k];
+      if (--indeg[v] == 0)
+        order[tail++] = v;
+    }
+  }
+  if (tail != g->n_nodes)
+    fatal("Error, the graph has a cycle");
+  free(indeg);
+  return order;
+}
+
+/**
+ * The intervals of a node are its subtree interval and the intervals
+ * of its children, sorted and merged. The children are labeled first,
+ * since the nodes are taken in reverse topological order.
+ */
+void build_reach_index(struct reach_index *ri, const struct csr_graph *g)
+{
+  long i, j, k, m, u, v, n_buf, alloc;
+  long *order, *start, *end;
+  bool *st;
+  struct lpairs *buf;
+  VEC(long) lo, hi;
+
+  ri->n_nodes = g->n_nodes;
+  ri->post = (long *)xmalloc(g->n_nodes*sizeof(long));
+  ri->low = (long *)xmalloc(g->n_nodes*sizeof(long));
+  st = get_spanning_tree(g);
+  number_forest(g, st, ri);
+  free(st);
+
+  order = topological_order(g);
+  start = (long *)xmalloc(g->n_nodes*sizeof(long));
+  end = (long *)xmalloc(g->n_nodes*sizeof(long));
+  VEC_INIT(long, lo);
+  VEC_INIT(long, hi);
+  alloc = 16;
+  buf = (struct lpairs *)xmalloc(alloc*sizeof(struct lpairs));
+  for (i = g->n_nodes - 1; i >= 0; i--) {
+    u = order[i];
+    n_buf = 0;
+    buf[n_buf].x = ri->low[u];
+    buf[n_buf].y = ri->post[u];
+    n_buf++;
+    csr_for_each_out(k, g, u) {
+      v = g->out_to[k];
+      for (j = start[v]; j < end[v]; j++) {
+        /* Intervals inside the subtree of u add nothing */
+        if ((ri->low[u] <= VEC_GET(lo, j)) && (VEC_GET(hi, j) <= ri->post[u]))
+          continue;
+        if (n_buf == alloc) {
+          alloc *= 2;
+          buf = (struct lpairs *)xrealloc(buf, alloc*sizeof(struct lpairs));
+        }
+        buf[n_buf].x = VEC_GET(lo, j);
+        buf[n_buf].y = VEC_GET(hi, j);
+        n_buf++;
+      }
+    }
+    qsort(buf, n_buf, sizeof(struct lpairs), interval_cmp);
+    start[u] = VEC_SIZE(lo);
+    VEC_PUSH(long, lo, buf[0].x);
+    VEC_PUSH(long, hi, buf[0].y);
+    for (m = 1; m < n_buf; m++) {
+      if (buf[m].x <= VEC_LAST(hi) + 1) {
+        if (buf[m].y > VEC_LAST(hi))
+          VEC_LAST(hi) = buf[m].y;
+      } else {
+        VEC_PUSH(long, lo, buf[m].x);
+        VEC_PUSH(long, hi, buf[m].y);
+      }
+    }
+    end[u] = VEC_SIZE(lo);
+  }
+  free(buf);
+  free(order);
+
+  /* Store the intervals of the nodes in order of id */
+  ri->offset = (long *)xmalloc((g->n_nodes + 1)*sizeof(long));
+  ri->offset[0] = 0;
+  for (u = 0; u < g->n_nodes; u++) {
+    ri->offset[u+1] = ri->offset[u] + (end[u] - start[u]);
+  }
+  m = ri->offset[g->n_nodes];
+  ri->lo = (long *)xmalloc((m + 1)*sizeof(long));
+  ri->hi = (long *)xmalloc((m + 1)*sizeof(long));
+  for (u = 0; u < g->n_nodes; u++) {
+    memcpy(ri->lo + ri->offset[u], lo.data + start[u], (end[u] - start[u])*sizeof(long));
+    memcpy(ri->hi + ri->offset[u], hi.data + start[u], (end[u] - start[u])*sizeof(long));
+  }
+  free(start);
+  free(end);
+  VEC_DESTROY(lo);
+  VEC_DESTROY(hi);
+  DEBUG("\n** Reachability index with %ld intervals done ** \n", m);
+}
+
+void free_reach_index(struct reach_index *ri)
+{
+  free(ri->post);
+  free(ri->low);
+  free(ri->offset);
+  free(ri->lo);
+  free(ri->hi);
+  ri->n_nodes = 0;
+}
@@ -0,0 +1,56 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Reachability index of a DAG by tree cover intervals
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___REACH_H
+#define ___REACH_H
+
+/**
+ * post[v] is the postorder number of v in a spanning forest of the
+ * graph, and its subtree has the numbers [low[v], post[v]]. The
+ * intervals lo[k], hi[k] for k in [offset[v], offset[v+1]) are the
+ * sorted and disjoint numbers of all the nodes reachable from v, the
+ * ones reached by arcs out of the forest included.
+ */
+struct reach_index {
+  long n_nodes;
+  long *post;
+  long *low;
+  long *offset;
+  long *lo;
+  long *hi;
+};
+
+void build_reach_index(struct reach_index *ri, const struct csr_graph *g);
+
+void free_reach_index(struct reach_index *ri);
+
+/**
+ * True if x is reachable from a in the graph, that is, when the arcs
+ * go from the parents to the children, if a is an ancestor of x.
+ * Every node is an ancestor of itself.
+ */
+static inline bool is_ancestor(const struct reach_index *ri, long a, long x)
+{
+  long p, l, h, m;
+
+  p = ri->post[x];
+  if ((ri->low[a] <= p) && (p <= ri->post[a]))
+    return true;
+  l = ri->offset[a];
+  h = ri->offset[a+1];
+  while (l < h) {
+    m = l + (h - l)/2;
+    if (ri->hi[m] < p)
+      l = m + 1;
+    else
+      h = m;
+  }
+  return (l < ri->offset[a+1]) && (ri->lo[l] <= p);
+}
+
+#endif /* ___REACH_H */
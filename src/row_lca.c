@@ -0,0 +1,185 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief LCA of a term with all the annotations by a sweep of the ontology
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "CA.h"
+#include "metric.h"
+#include "row_lca.h"
+
+#define ROOT   0
+#define INFTY  INT_MAX
+
+/**
+ * Keep the ancestors of the annotations of v, taken from the cache of
+ * the metrics, in the topological order of the nodes reachable from ROOT.
+ * The parents of an ancestor are also ancestors, so all the arcs that
+ * enter a kept node are kept.
+ */
+void build_row_lca(struct row_lca *rl, const struct csr_graph *g, const VEC(long) *v,
+                   const long *depth)
+{
+  long a, i, k, p, u, n_arcs;
+  const struct ancestors *anc;
+  struct long_list *tpl, *tmp;
+  struct list_head *pos;
+
+  rl->depth = depth;
+  rl->pos = (long *)xmalloc(g->n_nodes*sizeof(long));
+  for (u = 0; u < g->n_nodes; u++) {
+    rl->pos[u] = -1;
+  }
+  for (a = 0; a < (long)VEC_SIZE(*v); a++) {
+    anc = metric_ancestors(VEC_GET(*v, a));
+    for (i = 0; i < (long)VEC_SIZE(anc->node); i++) {
+      rl->pos[VEC_GET(anc->node, i)] = -2;
+    }
+  }
+
+  rl->order = (long *)xmalloc((g->n_nodes + 1)*sizeof(long));
+  rl->offset = (long *)xmalloc((g->n_nodes + 1)*sizeof(long));
+  rl->n_order = 0;
+  n_arcs = 0;
+  tpl = topological_sort(g, ROOT);
+  list_for_each(pos, &(tpl->list)) {
+    tmp = list_entry(pos, struct long_list, list);
+    u = tmp->item;
+    if (rl->pos[u] != -2)
+      continue;
+    rl->pos[u] = rl->n_order;
+    rl->order[rl->n_order] = u;
+    rl->offset[rl->n_order] = n_arcs;
+    rl->n_order++;
+    n_arcs += g->in_offset[u+1] - g->in_offset[u];
+  }
+  destroy_long_list(tpl);
+  free(tpl);
+  rl->offset[rl->n_order] = n_arcs;
+  for (u = 0; u < g->n_nodes; u++) {
+    if (rl->pos[u] == -2)
+      fatal("Error, the node %ld is not reachable from the root", u);
+  }
+
+  rl->parent = (long *)xmalloc((n_arcs + 1)*sizeof(long));
+  rl->cost = (long *)xmalloc((n_arcs + 1)*sizeof(long));
+  for (p = 0; p < rl->n_order; p++) {
+    i = rl->offset[p];
+    csr_for_each_in(k, g, rl->order[p]) {
+      rl->parent[i] = rl->pos[g->in_from[k]];
+      rl->cost[i] = g->in_cost[k];
+      i++;
+    }
+  }
+  DEBUG("\n** Row LCA with %ld nodes and %ld arcs done ** \n", rl->n_order, n_arcs);
+}
+
+void init_row_lca_ws(struct row_lca_ws *ws, const struct row_lca *rl)
+{
+  long p;
+
+  ws->best = (long *)xmalloc((rl->n_order + 1)*sizeof(long));
+  ws->dist = (long *)xmalloc((rl->n_order + 1)*sizeof(long));
+  ws->adist = (long *)xmalloc((rl->n_order + 1)*sizeof(long));
+  for (p = 0; p < rl->n_order; p++) {
+    ws->adist[p] = -1;
+  }
+}
+
+void free_row_lca_ws(struct row_lca_ws *ws)
+{
+  free(ws->best);
+  free(ws->dist);
+  free(ws->adist);
+}
+
+/**
+ * True if the position a is a better LCA than b: deeper, or as deep
+ * with a smaller id. -1 is worse than any position.
+ */
+static inline bool better_lca(const struct row_lca *rl, long a, long b)
+{
+  long da, db;
+
+  if (a == -1)
+    return false;
+  if (b == -1)
+    return true;
+  da = rl->depth[rl->order[a]];
+  db = rl->depth[rl->order[b]];
+  if (da != db)
+    return da > db;
+  return rl->order[a] < rl->order[b];
+}
+
+/**
+ * LCA of the term with the ancestors ax and every node of rl, with one
+ * pass in topological order. The common ancestors of the term and a node
+ * are the node itself, when it is an ancestor of the term, and the common
+ * ancestors of its parents, so the best of them is the best of the LCA of
+ * its parents. A shortest path from the LCA to the node enters it from a
+ * parent with the same LCA, which gives the distance.
+ */
+void row_lca_sweep(const struct row_lca *rl, const struct ancestors *ax,
+                   struct row_lca_ws *ws)
+{
+  long i, k, p, q, b, d, c;
+
+  for (i = 0; i < (long)VEC_SIZE(ax->node); i++) {
+    ws->adist[rl->pos[VEC_GET(ax->node, i)]] = VEC_GET(ax->dist, i);
+  }
+  for (p = 0; p < rl->n_order; p++) {
+    b = -1;
+    d = INFTY;
+    if (ws->adist[p] != -1) {
+      b = p;
+      d = 0;
+    }
+    for (k = rl->offset[p]; k < rl->offset[p+1]; k++) {
+      q = rl->parent[k];
+      c = ws->best[q];
+      if (better_lca(rl, c, b)) {
+        b = c;
+        d = ws->dist[q] + rl->cost[k];
+      } else if ((c == b) && (c != -1) && (ws->dist[q] + rl->cost[k] < d)) {
+        d = ws->dist[q] + rl->cost[k];
+      }
+    }
+    ws->best[p] = b;
+    ws->dist[p] = d;
+  }
+}
+
+/**
+ * Forget the ancestors of the term of the last sweep
+ */
+void row_lca_clear(const struct row_lca *rl, const struct ancestors *ax,
+                   struct row_lca_ws *ws)
+{
+  long i;
+
+  for (i = 0; i < (long)VEC_SIZE(ax->node); i++) {
+    ws->adist[rl->pos[VEC_GET(ax->node, i)]] = -1;
+  }
+}
+
+void free_row_lca(struct row_lca *rl)
+{
+  free(rl->order);
+  free(rl->pos);
+  free(rl->offset);
+  free(rl->parent);
+  free(rl->cost);
+  rl->n_order = 0;
+}
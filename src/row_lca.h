@@ -0,0 +1,73 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief LCA of a term with all the annotations by a sweep of the ontology
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___ROW_LCA_H
+#define ___ROW_LCA_H
+
+/**
+ * The ancestors of the annotations in topological order. The parents
+ * of the node order[p] are the positions [offset[p], offset[p+1]) of
+ * parent, with the costs of their arcs. pos[u] is the position of the
+ * node u, or -1 when u is not an ancestor of any annotation.
+ */
+struct row_lca {
+  long n_order;
+  long *order;
+  long *pos;
+  long *offset;
+  long *parent;
+  long *cost;
+  const long *depth;
+};
+
+/**
+ * Buffers of a sweep, owned by one thread. After row_lca_sweep, best[p]
+ * is the position of the LCA of the term and order[p], and dist[p] the
+ * distance from it to order[p]. adist[p] is the distance from order[p]
+ * to the term, or -1 when it is not one of its ancestors.
+ */
+struct row_lca_ws {
+  long *best;
+  long *dist;
+  long *adist;
+};
+
+void build_row_lca(struct row_lca *rl, const struct csr_graph *g, const VEC(long) *v,
+                   const long *depth);
+
+void init_row_lca_ws(struct row_lca_ws *ws, const struct row_lca *rl);
+
+void free_row_lca_ws(struct row_lca_ws *ws);
+
+void row_lca_sweep(const struct row_lca *rl, const struct ancestors *ax,
+                   struct row_lca_ws *ws);
+
+void row_lca_clear(const struct row_lca *rl, const struct ancestors *ax,
+                   struct row_lca_ws *ws);
+
+void free_row_lca(struct row_lca *rl);
+
+/**
+ * LCA of the term of the last sweep and the annotation y, with the
+ * distances from it to both
+ */
+static inline long row_lca_query(const struct row_lca *rl, const struct row_lca_ws *ws,
+                                 long y, long *dax, long *day)
+{
+  long p, b;
+
+  p = rl->pos[y];
+  b = ws->best[p];
+  if (b == -1)
+    fatal("Error with the lowest common ancestor");
+  *dax = ws->adist[b];
+  *day = ws->dist[p];
+  return rl->order[b];
+}
+
+#endif /* ___ROW_LCA_H */
@@ -6,6 +6,7 @@
  */
 
 #include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -19,89 +20,288 @@
 #include "memory.h"
 #include "util.h"
 #include "metric.h"
+#include "batch.h"
+#include "row_lca.h"
+#include "arena.h"
 #include "tax_sim.h"
 
-#define ROOT       0
+#define ROOT        0
+#define PAIRS_BLOCK (1UL << 20)
 
-struct args_metric {
-     long start;
-     long end;
-     struct graph *gm;
+/**
+ * Results of the pairs with index in [start, start+size). The pairs are
+ * the (i, j) with i <= j of the annotations, in row order. The threads
+ * take chunks of pairs of the block, or rows of the block with the row
+ * sweep, from the counter next. There are two blocks, so one is printed
+ * while the pairs of the other are calculated.
+ */
+struct pairs_block {
+     uint64_t start;
+     uint64_t size;
+     uint64_t next;
+     uint64_t chunk;
+     double *sim;
+     VEC(long) **lca;
 };
 
-struct terms_pair {
-     long x;
-     long y;
-     double sim;
-     VEC(long) *lca;
-};
+static double (*metricPtr)(const struct csr_graph *g, long x, long y);;
+static double (*metricKnownPtr)(long x, long y, long lca, long dax, long day);
+static struct csr_graph *gm;
+static struct batch_lca batch;
+static bool use_batch;
+static struct row_lca rows;
+static bool use_rows;
+static const VEC(long) *annt;
+static const struct str_arena *names;
+static const long *desc;
+static struct pairs_block *work;
+static pthread_barrier_t barrier;
 
-typedef struct terms_pair terms_pair_s;
-DEFINE_VEC(terms_pair_s);
+static inline uint64_t number_of_pairs(uint64_t n)
+{
+     return (n*(n+1))/2;
+}
 
-VEC(terms_pair_s) pterms;
-static unsigned long n_pairs;
-static double (*metricPtr)(const struct graph *g, long x, long y);;
-static struct graph *gm;
+/**
+ * Index of the first pair of the row i
+ */
+static inline uint64_t row_offset(uint64_t i, uint64_t n)
+{
+     return (i*(2*n - i + 1))/2;
+}
 
-static void get_pairs_of_terms(const VEC(long) *v)
+/**
+ * Position (i, j) in the upper triangle of the pair with index p
+ */
+void pair_of_index(uint64_t p, uint64_t n, uint64_t *i, uint64_t *j)
 {
-     unsigned long i, j, n;
-     terms_pair_s item;
+     double b;
+     uint64_t r;
 
-     n = VEC_SIZE(*v);
-     n_pairs = (n*(n+1))/2;
-     VEC_INIT_N(terms_pair_s, pterms, n_pairs);
-     for (i = 0; i < n; i++) {
-	  for (j = i; j < n; j++) {
-	       item.x = VEC_GET(*v, i);
-	       item.y = VEC_GET(*v, j);
-	       item.sim = 0.0;
-	       item.lca = NULL;
-	       VEC_PUSH(terms_pair_s, pterms, item);
-	  }
-     }
+     b = 2.0*n + 1.0;
+     r = (uint64_t)((b - sqrt(b*b - 8.0*p))/2.0);
+     if (r >= n)
+	  r = n - 1;
+     /* Fix the rounding errors of the square root */
+     while (row_offset(r, n) > p)
+	  r--;
+     while ((r + 1 < n) && (row_offset(r + 1, n) <= p))
+	  r++;
+     *i = r;
+     *j = r + (p - row_offset(r, n));
+}
+
+static void init_pairs_block(struct pairs_block *blk, uint64_t size, uint64_t chunk,
+			     bool print_lca)
+{
+     blk->start = 0;
+     blk->size = 0;
+     blk->next = 0;
+     blk->chunk = chunk;
+     blk->sim = (double *)xcalloc(size, sizeof(double));
+     blk->lca = NULL;
+     if (print_lca)
+	  blk->lca = (VEC(long) **)xcalloc(size, sizeof(VEC(long) *));
 }
 
-static void print_terms_pairs(char **descrptions, bool print_lca)
+static void free_pairs_block(struct pairs_block *blk)
 {
-     unsigned long i, j;
-     terms_pair_s item;
+     free(blk->sim);
+     free(blk->lca);
+}
 
+static void print_header(bool print_lca)
+{
      if (print_lca) 
 	  printf("\nTerm1\tTerm2\tSimilarity\tLCA\n\n");
      else
 	  printf("\nTerm1\tTerm2\tSimilarity\n\n");
+}
+
+/**
+ * Print the pairs of the block and free their LCA sets
+ */
+static void print_pairs_block(struct pairs_block *blk)
+{
+     uint64_t k, i, j, n;
+     long x, y;
+     size_t l;
+     VEC(long) *lca;
 
-     for (i = 0; i < VEC_SIZE(pterms); i++) {
-	  item = VEC_GET(pterms, i);
-	  printf("%s\t%s\t%.5f", descrptions[item.x], descrptions[item.y], item.sim);
-	  if (print_lca) {
-	       for (j = 0; j < VEC_SIZE(*(item.lca)); j++) {
-		    printf("\t%s\t", descrptions[VEC_GET(*(item.lca), j)]);
+     n = VEC_SIZE(*annt);
+     pair_of_index(blk->start, n, &i, &j);
+     for (k = 0; k < blk->size; k++) {
+	  x = VEC_GET(*annt, i);
+	  y = VEC_GET(*annt, j);
+	  printf("%s\t%s\t%.5f", str_arena_get(names, desc[x]),
+		 str_arena_get(names, desc[y]), blk->sim[k]);
+	  if (blk->lca) {
+	       lca = blk->lca[k];
+	       for (l = 0; l < VEC_SIZE(*lca); l++) {
+		    printf("\t%s\t", str_arena_get(names, desc[VEC_GET(*lca, l)]));
 	       }
+	       VEC_DESTROY(*lca);
+	       free(lca);
+	       blk->lca[k] = NULL;
 	  }
 	  printf("\n");
+	  if (++j == n) {
+	       i++;
+	       j = i;
+	  }
      }
 }
 
-static void *calculate_similarity(void *args)
+/**
+ * Similarity of the pairs [start, end) from the LCA given by the batch
+ */
+static void calculate_similarity_batch(struct pairs_block *blk, uint64_t start,
+				       uint64_t end, struct batch_lca_ws *ws)
 {
-     long i, start, end;
-     struct args_metric *am;
-     terms_pair_s item;
+     uint64_t p, i, j, n;
+     long x, y;
+
+     n = VEC_SIZE(*annt);
+     pair_of_index(start, n, &i, &j);
+     batch_lca_range(&batch, ws, i, j, end - start);
+     for (p = start; p < end; p++) {
+	  x = VEC_GET(*annt, i);
+	  y = VEC_GET(*annt, j);
+	  blk->sim[p - blk->start] = (*metricKnownPtr)(x, y, ws->lca[p - start],
+						       ws->dax[p - start], ws->day[p - start]);
+	  if (blk->lca)
+	       blk->lca[p - blk->start] = lca_vector(x, y);
+	  if (++j == n) {
+	       i++;
+	       j = i;
+	  }
+     }
+}
 
-     am = (struct args_metric *)args;
-     start = am->start;
-     end = am->end;
-     for (i = start; i < end; i++) {
-	  item = VEC_GET(pterms, i);
-	  (VEC_GET(pterms, i)).sim = (*metricPtr)(gm, item.x, item.y);
+static void calculate_similarity(struct pairs_block *blk, uint64_t start, uint64_t end,
+				 struct batch_lca_ws *ws)
+{
+     uint64_t p, i, j, n;
+     long x, y;
+
+     if (use_batch) {
+	  calculate_similarity_batch(blk, start, end, ws);
+	  return;
+     }
+     n = VEC_SIZE(*annt);
+     pair_of_index(start, n, &i, &j);
+     for (p = start; p < end; p++) {
+	  x = VEC_GET(*annt, i);
+	  y = VEC_GET(*annt, j);
+	  blk->sim[p - blk->start] = (*metricPtr)(gm, x, y);
+	  if (blk->lca)
+	       blk->lca[p - blk->start] = lca_vector(x, y);
+	  if (++j == n) {
+	       i++;
+	       j = i;
+	  }
      }
+}
+
+/**
+ * Similarity of the pairs [start, end) of the row i, from the LCA of
+ * its term with all the annotations found by one sweep
+ */
+static void calculate_similarity_row(struct pairs_block *blk, uint64_t i,
+				     uint64_t start, uint64_t end,
+				     struct row_lca_ws *ws)
+{
+     uint64_t p, j, n;
+     long x, y, lca, dax, day;
+     const struct ancestors *ax;
+
+     n = VEC_SIZE(*annt);
+     x = VEC_GET(*annt, i);
+     ax = metric_ancestors(x);
+     row_lca_sweep(&rows, ax, ws);
+     j = i + (start - row_offset(i, n));
+     for (p = start; p < end; p++, j++) {
+	  y = VEC_GET(*annt, j);
+	  lca = row_lca_query(&rows, ws, y, &dax, &day);
+	  blk->sim[p - blk->start] = (*metricKnownPtr)(x, y, lca, dax, day);
+	  if (blk->lca)
+	       blk->lca[p - blk->start] = lca_vector(x, y);
+     }
+     row_lca_clear(&rows, ax, ws);
+}
+
+/**
+ * Calculate the rows of the block until all of them are taken. Only
+ * the first and the last rows can be split with other blocks.
+ */
+static void calculate_block_rows(struct pairs_block *blk)
+{
+     uint64_t first, last, i, j, n, start, end;
+     struct row_lca_ws ws;
+
+     n = VEC_SIZE(*annt);
+     end = blk->start + blk->size;
+     pair_of_index(blk->start, n, &first, &j);
+     pair_of_index(end - 1, n, &last, &j);
+     init_row_lca_ws(&ws, &rows);
+     for (;;) {
+	  i = first + __atomic_fetch_add(&blk->next, 1, __ATOMIC_RELAXED);
+	  if (i > last)
+	       break;
+	  start = row_offset(i, n);
+	  if (start < blk->start)
+	       start = blk->start;
+	  calculate_similarity_row(blk, i, start, MIN(row_offset(i + 1, n), end), &ws);
+     }
+     free_row_lca_ws(&ws);
+}
+
+/**
+ * Calculate chunks of pairs of the block until all of them are taken.
+ * ws is the batch LCA workspace of the thread.
+ */
+static void calculate_block(struct pairs_block *blk, struct batch_lca_ws *ws)
+{
+     uint64_t start, end;
+
+     if (use_rows) {
+	  calculate_block_rows(blk);
+	  return;
+     }
+     end = blk->start + blk->size;
+     for (;;) {
+	  start = blk->start + __atomic_fetch_add(&blk->next, blk->chunk, __ATOMIC_RELAXED);
+	  if (start >= end)
+	       break;
+	  calculate_similarity(blk, start, MIN(start + blk->chunk, end), ws);
+     }
+}
+
+/**
+ * The workers and the main thread meet at the barrier before and after
+ * each block. The main thread prints the previous block before it joins
+ * the workers on the block work. NULL in work ends the workers.
+ */
+static void *similarity_worker(void *args)
+{
+     struct batch_lca_ws ws;
+
+     (void)args;
+     if (use_batch)
+	  init_batch_lca_ws(&ws, &batch);
+     for (;;) {
+	  pthread_barrier_wait(&barrier);
+	  if (!work)
+	       break;
+	  calculate_block(work, &ws);
+	  pthread_barrier_wait(&barrier);
+     }
+     if (use_batch)
+	  free_batch_lca_ws(&ws);
      return NULL;
 }
 
-static long get_max_group_depth(const VEC(long) *v1, char **desc)
+static long get_max_group_depth(const VEC(long) *v1)
 {
      long max_depth = 0; /* ROOT depth */
      long max_node = ROOT;
@@ -118,78 +318,116 @@ static long get_max_group_depth(const VEC(long) *v1, char **desc)
 	  }
      }
      printf("The node deepest in the annotations is %s with depth %ld\n",
-	    desc[max_node], max_depth);
+	    str_arena_get(names, desc[max_node]), max_depth);
      return max_depth;
 }
 
-static void calculate_lca(void)
-{
-  unsigned i;
-  terms_pair_s item;
-
-  for (i = 0; i < VEC_SIZE(pterms); i++) {
-    item = VEC_GET(pterms, i);
-    (VEC_GET(pterms, i)).lca = lca_vector(item.x, item.y);
-  }
-}
-
-void taxonomic_similarity(struct graph *g, const VEC(long) *v, unsigned n_threads,
-                          char **descrptions, enum metric d, bool print_lca)
+void taxonomic_similarity(struct csr_graph *g, const VEC(long) *v,
+                          const struct str_arena *strings, const long *descrptions,
+                          const struct sim_options *opt)
 {
-     struct args_metric args[n_threads+1];
-     pthread_t thread[n_threads];
+     pthread_t thread[opt->n_threads];
      pthread_attr_t attr;
-     long i, start, step, max_depth;
+     struct pairs_block blk[2], *prev;
+     struct batch_lca_ws ws;
+     uint64_t n_pairs, chunk_size, start;
+     unsigned i, n_threads;
+     long max_depth;
+     enum metric d;
+     bool print_lca;
      int tc;
 
      gm = g;
-     n_pairs = 0;
-     get_pairs_of_terms(v);
-     init_metric_data(g);
-
-     if (print_lca)
-	  calculate_lca();
+     annt = v;
+     names = strings;
+     desc = descrptions;
+     n_threads = opt->n_threads;
+     chunk_size = opt->chunk_size;
+     d = opt->d;
+     print_lca = opt->print_lca;
+     n_pairs = number_of_pairs(VEC_SIZE(*v));
+     init_metric_data(g, opt->engine, opt->labels);
 
      if (n_pairs < n_threads)
 	  n_threads = n_pairs;
+     if (n_threads == 0)
+	  n_threads = 1;
+     if (chunk_size == 0)
+	  chunk_size = DEFAULT_CHUNK_SIZE;
+     precompute_ancestors(v, n_threads, opt->batch || opt->rows);
 
      if (d == DTAX) {
 	  metricPtr = &sim_dtax;
+	  metricKnownPtr = &sim_dtax_known;
      } else if (d == DPS) {
 	  metricPtr = &sim_dps;
+	  metricKnownPtr = &sim_dps_known;
      } else {
-	  max_depth = get_max_group_depth(v, descrptions);
+	  max_depth = get_max_group_depth(v);
 	  set_max_depth(max_depth);
 	  metricPtr = &sim_str;
+	  metricKnownPtr = &sim_str_known;
      }
-     /* Initialize and set thread detached attribute */
+     use_batch = opt->batch;
+     if (use_batch) {
+	  build_batch_lca(&batch, v, get_nodes_depth(), g->n_nodes);
+	  init_batch_lca_ws(&ws, &batch);
+	  /* One chunk of rows per thread, since the batch LCA visits the ancestors once per chunk */
+	  chunk_size = MAX(chunk_size, (MIN(n_pairs, PAIRS_BLOCK) + n_threads - 1)/n_threads);
+     }
+     use_rows = opt->rows;
+     if (use_rows)
+	  build_row_lca(&rows, g, v, get_nodes_depth());
+     init_pairs_block(&blk[0], MIN(n_pairs, PAIRS_BLOCK), chunk_size, print_lca);
+     init_pairs_block(&blk[1], MIN(n_pairs, PAIRS_BLOCK), chunk_size, print_lca);
+     print_header(print_lca);
+     /* The main thread is one of the n_threads workers */
+     tc = pthread_barrier_init(&barrier, NULL, n_threads);
+     if (tc)
+	  fatal("ERROR; return code from pthread_barrier_init() is %d\n", tc);
      pthread_attr_init(&attr);
      pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE);
-     step = lrint(n_pairs/n_threads);
-     for (i = 0; i < n_threads; i++) {
-	  args[i].start = i*step;
-	  args[i].end = (i+1)*step;
-	  tc = pthread_create(&thread[i], &attr, calculate_similarity, (void *)(&args[i]));
+     for (i = 1; i < n_threads; i++) {
+	  tc = pthread_create(&thread[i], &attr, similarity_worker, NULL);
 	  if (tc)
 	       fatal("ERROR; return code from pthread_create() is %d\n", tc);
      }
-     start = n_threads*step;
-     if ((unsigned)start < n_pairs) {
-	  args[i].start = start;
-	  args[i].end = n_pairs;
-	  calculate_similarity((void *)(&args[i]));
+     prev = NULL;
+     work = &blk[0];
+     for (start = 0; start < n_pairs; start += prev->size) {
+	  work->start = start;
+	  work->size = MIN(n_pairs - start, PAIRS_BLOCK);
+	  work->next = 0;
+	  pthread_barrier_wait(&barrier);
+	  if (prev)
+	       print_pairs_block(prev);
+	  calculate_block(work, &ws);
+	  pthread_barrier_wait(&barrier);
+	  prev = work;
+	  work = (work == &blk[0]) ? &blk[1] : &blk[0];
      }
+     work = NULL;
+     pthread_barrier_wait(&barrier);
+     if (prev)
+	  print_pairs_block(prev);
      /* Free attribute and wait for the other threads */
      pthread_attr_destroy(&attr);
-     for(i = 0; i < n_threads; i++) {
+     for (i = 1; i < n_threads; i++) {
 	  tc = pthread_join(thread[i], NULL);
 	  if (tc)
 	       fatal("ERROR; return code from pthread_join() is %d\n", tc);
 #ifdef PRGDEBUG
-	  printf("Completed join with thread %ld\n",i );
+	  printf("Completed join with thread %u\n", i);
 #endif
      }
-     print_terms_pairs(descrptions, print_lca);
+     pthread_barrier_destroy(&barrier);
+     if (use_batch) {
+	  free_batch_lca_ws(&ws);
+	  free_batch_lca(&batch);
+     }
+     if (use_rows)
+	  free_row_lca(&rows);
+     free_pairs_block(&blk[0]);
+     free_pairs_block(&blk[1]);
      free_metric();
-     VEC_DESTROY(pterms);
 }
@@ -8,8 +8,32 @@
 #ifndef ___TAX_SIM_H
 #define ___TAX_SIM_H
 
-void taxonomic_similarity(struct graph *g, const VEC(long) *v,
-                          unsigned n_threads, char **descrptions,
-                          enum metric, bool print_lca);
+/* Pairs of terms taken by a thread at a time */
+#define DEFAULT_CHUNK_SIZE 64
+
+/**
+ * Options of the computation of the similarity between all the pairs.
+ * With batch, the LCA of the pairs are found together by chunks of
+ * pairs, instead of one by one with the engine. With rows, the LCA of
+ * a term with all the annotations of its row are found by one sweep
+ * of the ontology. With labels, the distances of the graph are indexed
+ * by 2-hop labels.
+ */
+struct sim_options {
+  unsigned n_threads;
+  uint64_t chunk_size;
+  enum metric d;
+  enum lca_engine engine;
+  bool batch;
+  bool rows;
+  bool labels;
+  bool print_lca;
+};
+
+void pair_of_index(uint64_t p, uint64_t n, uint64_t *i, uint64_t *j);
+
+void taxonomic_similarity(struct csr_graph *g, const VEC(long) *v,
+                          const struct str_arena *strings, const long *descrptions,
+                          const struct sim_options *opt);
 
 #endif /* ___TAX_SIM_H */
@@ -0,0 +1,203 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Open addressing map of the names of the terms to their positions
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "memory.h"
+#include "hash_function.h"
+#include "arena.h"
+#include "term_map.h"
+
+/* The map grows when more than 7/8 of the slots are used */
+#define MAX_LOAD(n_groups)  ((n_groups)*TERM_MAP_GROUP/8*7)
+
+static inline uint8_t hash_tag(uint32_t h)
+{
+  return h & 0x7f;
+}
+
+/**
+ * Mask with the bit i set when the byte i of the group at ctrl is c
+ */
+static inline unsigned group_match(const uint8_t *ctrl, uint8_t c)
+{
+#if defined(__SSE2__)
+  __m128i g;
+
+  g = _mm_loadu_si128((const __m128i *)ctrl);
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(g, _mm_set1_epi8(c)));
+#else
+  unsigned i, m;
+
+  m = 0;
+  for (i = 0; i < TERM_MAP_GROUP; i++) {
+    if (ctrl[i] == c)
+      m |= 1u << i;
+  }
+  return m;
+#endif
+}
+
+static void alloc_groups(struct term_map *m, long n_groups)
+{
+  m->n_groups = n_groups;
+  m->ctrl = (uint8_t *)xmalloc(n_groups*TERM_MAP_GROUP);
+  memset(m->ctrl, TERM_MAP_EMPTY, n_groups*TERM_MAP_GROUP);
+  m->slots = (struct term_slot *)xmalloc(n_groups*TERM_MAP_GROUP*sizeof(struct term_slot));
+}
+
+/**
+ * Position of the first empty slot of the probe sequence of the hash h.
+ * The groups are probed by triangular steps, which visit all of them
+ * because their number is a power of 2.
+ */
+static long empty_slot(const struct term_map *m, uint32_t h)
+{
+  long g, step;
+  unsigned e;
+
+  g = (h >> 7) & (m->n_groups - 1);
+  for (step = 1; ; step++) {
+    e = group_match(m->ctrl + g*TERM_MAP_GROUP, TERM_MAP_EMPTY);
+    if (e)
+      return g*TERM_MAP_GROUP + __builtin_ctz(e);
+    g = (g + step) & (m->n_groups - 1);
+  }
+}
+
+/**
+ * Double the number of groups. The slots are moved with their inline
+ * hashes, without reading the keys.
+ */
+static void grow(struct term_map *m)
+{
+  long k, n, p;
+  uint8_t *ctrl;
+  struct term_slot *slots;
+
+  ctrl = m->ctrl;
+  slots = m->slots;
+  n = m->n_groups*TERM_MAP_GROUP;
+  alloc_groups(m, 2*m->n_groups);
+  for (k = 0; k < n; k++) {
+    if (ctrl[k] != TERM_MAP_EMPTY) {
+      p = empty_slot(m, slots[k].hash);
+      m->ctrl[p] = ctrl[k];
+      m->slots[p] = slots[k];
+    }
+  }
+  free(ctrl);
+  free(slots);
+}
+
+/**
+ * The map with room for n keys without growing. The keys are handles
+ * of strings of the arena strings.
+ */
+void init_term_map(struct term_map *m, const struct str_arena *strings, long n)
+{
+  long n_groups;
+
+  n_groups = 1;
+  while (MAX_LOAD(n_groups) < n)
+    n_groups *= 2;
+  alloc_groups(m, n_groups);
+  m->size = 0;
+  m->strings = strings;
+}
+
+/**
+ * Slot of the key s of length len, or the empty slot where it goes,
+ * with -1 in found
+ */
+static long probe(const struct term_map *m, const char *s, unsigned len, uint32_t h,
+                  bool *found)
+{
+  long g, step, k;
+  unsigned match, e;
+  uint8_t tag;
+  const struct term_slot *slot;
+
+  tag = hash_tag(h);
+  g = (h >> 7) & (m->n_groups - 1);
+  for (step = 1; ; step++) {
+    match = group_match(m->ctrl + g*TERM_MAP_GROUP, tag);
+    while (match) {
+      k = g*TERM_MAP_GROUP + __builtin_ctz(match);
+      slot = &m->slots[k];
+      if ((slot->hash == h) && (slot->len == len) &&
+          !memcmp(str_arena_get(m->strings, slot->key), s, len)) {
+        *found = true;
+        return k;
+      }
+      match &= match - 1;
+    }
+    e = group_match(m->ctrl + g*TERM_MAP_GROUP, TERM_MAP_EMPTY);
+    if (e) {
+      *found = false;
+      return g*TERM_MAP_GROUP + __builtin_ctz(e);
+    }
+    g = (g + step) & (m->n_groups - 1);
+  }
+}
+
+/**
+ * Add the string of the arena with handle key and length len with the
+ * value. Return -1, or the value of the key when it is already in the
+ * map, and then the map is not changed.
+ */
+long term_map_add(struct term_map *m, long key, unsigned len, long value)
+{
+  long k;
+  uint32_t h;
+  bool found;
+
+  h = __hash_function(str_arena_get(m->strings, key), len);
+  k = probe(m, str_arena_get(m->strings, key), len, h, &found);
+  if (found)
+    return m->slots[k].value;
+  if (m->size + 1 > MAX_LOAD(m->n_groups)) {
+    grow(m);
+    k = empty_slot(m, h);
+  }
+  m->ctrl[k] = hash_tag(h);
+  m->slots[k].hash = h;
+  m->slots[k].len = len;
+  m->slots[k].key = key;
+  m->slots[k].value = value;
+  m->size++;
+  return -1;
+}
+
+/**
+ * Value of the string s of length len, which does not need to end with
+ * '\0', or -1 when it is not in the map. It only reads the map.
+ */
+long term_map_find(const struct term_map *m, const char *s, unsigned len)
+{
+  long k;
+  bool found;
+
+  k = probe(m, s, len, __hash_function(s, len), &found);
+  return found ? m->slots[k].value : -1;
+}
+
+void free_term_map(struct term_map *m)
+{
+  free(m->ctrl);
+  free(m->slots);
+  m->size = 0;
+  m->n_groups = 0;
+}
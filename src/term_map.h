@@ -0,0 +1,63 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Open addressing map of the names of the terms to their positions
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___TERM_MAP_H
+#define ___TERM_MAP_H
+
+#include <stdint.h>
+
+#define TERM_MAP_GROUP  16
+#define TERM_MAP_EMPTY  0x80
+
+/**
+ * The key of a slot is the handle of a string of the arena of the map,
+ * with its hash and length inline, so the growth of the map and most
+ * of the failed comparisons do not read the strings.
+ */
+struct term_slot {
+  uint32_t hash;
+  uint32_t len;
+  long key;
+  long value;
+};
+
+/**
+ * The slots are split in n_groups groups of TERM_MAP_GROUP, and ctrl
+ * has a byte by slot: TERM_MAP_EMPTY, or the low 7 bits of the hash of
+ * its key. A lookup compares the bytes of a whole group at a time with
+ * the bits of the key, and reads only the slots that match. The lookups
+ * keep no state in the map, so the threads can share it while no key
+ * is added.
+ */
+struct term_map {
+  long size;
+  long n_groups;
+  uint8_t *ctrl;
+  struct term_slot *slots;
+  const struct str_arena *strings;
+};
+
+/**
+ * Iterate over the used slots of a map
+ * @slot:   struct term_slot *
+ * @k:      long, index of the slot
+ * @m:      struct term_map *
+ */
+#define term_map_for_each(slot, k, m)					\
+  for (k = 0; k < (m)->n_groups*TERM_MAP_GROUP; k++)                    \
+    if (((m)->ctrl[k] != TERM_MAP_EMPTY) && (slot = &(m)->slots[k]))
+
+void init_term_map(struct term_map *m, const struct str_arena *strings, long n);
+
+long term_map_add(struct term_map *m, long key, unsigned len, long value);
+
+long term_map_find(const struct term_map *m, const char *s, unsigned len);
+
+void free_term_map(struct term_map *m);
+
+#endif /* ___TERM_MAP_H */
@@ -0,0 +1,131 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the blocked Floyd-Warshall against the brute force distances
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "apsp.h"
+#include "dag.h"
+
+static void check_all(const struct csr_graph *g, const long *dmin, unsigned n_threads)
+{
+  long n, s, t;
+  struct dist_matrix m;
+
+  n = g->n_nodes;
+  apsp_all(g, &m, n_threads);
+  for (s = 0; s < n; s++) {
+    for (t = 0; t < n; t++) {
+      if (dist_matrix_get(&m, s, t) != dmin[s*n + t])
+        fatal("apsp_all(%ld, %ld) is %ld instead of %ld with %u threads\n", s, t,
+              dist_matrix_get(&m, s, t), dmin[s*n + t], n_threads);
+    }
+  }
+  free_dist_matrix(&m);
+}
+
+/**
+ * Shortest distances of the subgraph of g induced by the k nodes, with
+ * the Floyd-Warshall recurrence over the positions of the nodes
+ */
+static long *brute_subset_dist(const struct csr_graph *g, const long *nodes, long k)
+{
+  long i, j, w, a;
+  long *d;
+
+  d = (long *)xmalloc((k*k + 1)*sizeof(long));
+  for (i = 0; i < k; i++) {
+    for (j = 0; j < k; j++) {
+      d[i*k + j] = (i == j) ? 0 : CHECK_INFTY;
+      csr_for_each_out(a, g, nodes[i]) {
+        if ((g->out_to[a] == nodes[j]) && (g->out_cost[a] < d[i*k + j]))
+          d[i*k + j] = g->out_cost[a];
+      }
+    }
+  }
+  for (w = 0; w < k; w++) {
+    for (i = 0; i < k; i++) {
+      if (d[i*k + w] == CHECK_INFTY)
+        continue;
+      for (j = 0; j < k; j++) {
+        if ((d[w*k + j] != CHECK_INFTY) && (d[i*k + w] + d[w*k + j] < d[i*k + j]))
+          d[i*k + j] = d[i*k + w] + d[w*k + j];
+      }
+    }
+  }
+  return d;
+}
+
+/**
+ * apsp_subset on a random subset of the nodes of g, in random order,
+ * against the brute force distances of the induced subgraph
+ */
+static void check_subset(const struct csr_graph *g, unsigned n_threads, uint64_t *seed)
+{
+  long n, k, i, j, u;
+  long *nodes, *d;
+  struct dist_matrix m;
+
+  n = g->n_nodes;
+  nodes = (long *)xmalloc((n + 1)*sizeof(long));
+  for (u = 0; u < n; u++)
+    nodes[u] = u;
+  for (u = n - 1; u > 0; u--) {
+    i = check_rand(seed) % (u + 1);
+    j = nodes[u];
+    nodes[u] = nodes[i];
+    nodes[i] = j;
+  }
+  k = (n > 0) ? check_rand(seed) % (n + 1) : 0;
+  d = brute_subset_dist(g, nodes, k);
+  apsp_subset(g, nodes, k, &m, n_threads);
+  for (i = 0; i < k; i++) {
+    if (m.nodes[i] != nodes[i])
+      fatal("apsp_subset has the node %ld in the row %ld instead of %ld\n",
+            m.nodes[i], i, nodes[i]);
+    for (j = 0; j < k; j++) {
+      if (dist_matrix_get(&m, i, j) != d[i*k + j])
+        fatal("apsp_subset(%ld, %ld) is %ld instead of %ld with %u threads\n",
+              nodes[i], nodes[j], dist_matrix_get(&m, i, j), d[i*k + j], n_threads);
+    }
+  }
+  free_dist_matrix(&m);
+  free(nodes);
+  free(d);
+}
+
+int main(void)
+{
+  static const long sizes[] = {1, 3, APSP_TILE - 1, APSP_TILE, APSP_TILE + 1, 3*APSP_TILE + 7};
+  static const unsigned threads[] = {1, 2, 4, 7};
+  long i, t;
+  long *dmin;
+  uint64_t seed;
+  struct csr_graph g;
+
+  seed = 20142;
+  for (i = 0; i < (long)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    random_dag(&g, sizes[i], 4, 5, &seed);
+    dmin = brute_min_dist(&g);
+    for (t = 0; t < (long)(sizeof(threads)/sizeof(threads[0])); t++) {
+      check_all(&g, dmin, threads[t]);
+      check_subset(&g, threads[t], &seed);
+    }
+    free(dmin);
+    free_csr_graph(&g);
+  }
+  printf("check_apsp: ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the batch LCA of the pairs of annotations against brute force LCA
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "CA.h"
+#include "metric.h"
+#include "batch.h"
+#include "dag.h"
+
+/**
+ * batch_lca_range of count pairs from the pair (i, j), in the order of
+ * the rows of the upper triangle of the k annotations of v
+ */
+static void check_range(const struct batch_lca *bl, struct batch_lca_ws *ws,
+                        const VEC(long) *v, long i, long j, long count,
+                        const long *dmin, const long *depth, long n)
+{
+  long p, k, x, y, lca;
+
+  k = VEC_SIZE(*v);
+  batch_lca_range(bl, ws, i, j, count);
+  for (p = 0; p < count; p++) {
+    x = VEC_GET(*v, i);
+    y = VEC_GET(*v, j);
+    lca = brute_lca(dmin, depth, n, x, y, NULL);
+    if ((ws->lca[p] != lca) || (ws->dax[p] != dmin[lca*n + x])
+        || (ws->day[p] != dmin[lca*n + y]))
+      fatal("batch_lca_range gives %ld at %ld and %ld for (%ld, %ld) instead of "
+            "%ld at %ld and %ld\n", ws->lca[p], ws->dax[p], ws->day[p], i, j,
+            lca, dmin[lca*n + x], dmin[lca*n + y]);
+    if (++j == k) {
+      i++;
+      j = i;
+    }
+  }
+}
+
+/**
+ * The whole triangle, single pairs and random ranges of pairs of k
+ * annotations taken with repetition from the nodes of a random ontology.
+ * The workspace is shared by all the ranges, so it grows and is reused.
+ */
+static void check_graph(long n, long k, long max_parents, uint64_t *seed)
+{
+  long a, t, i, j, left, count;
+  long *dmin, *dmax;
+  struct csr_graph g;
+  struct batch_lca bl;
+  struct batch_lca_ws ws;
+  VEC(long) v;
+
+  random_dag(&g, n, max_parents, 3, seed);
+  dmin = brute_min_dist(&g);
+  dmax = brute_max_dist(&g);
+  VEC_INIT(long, v);
+  for (a = 0; a < k; a++)
+    VEC_PUSH(long, v, check_rand(seed) % n);
+  init_metric_data(&g, LCA_MERGE, false);
+  precompute_ancestors(&v, 2, true);
+  build_batch_lca(&bl, &v, get_nodes_depth(), n);
+  init_batch_lca_ws(&ws, &bl);
+  for (t = 0; t < 40; t++) {
+    i = check_rand(seed) % k;
+    j = i + check_rand(seed) % (k - i);
+    left = (k - j) + ((k - i - 1)*(k - i))/2;
+    count = (t % 4 == 0) ? 1 : 1 + check_rand(seed) % left;
+    check_range(&bl, &ws, &v, i, j, count, dmin, dmax, n);
+  }
+  check_range(&bl, &ws, &v, 0, 0, (k*(k + 1))/2, dmin, dmax, n);
+  free_batch_lca_ws(&ws);
+  free_batch_lca(&bl);
+  free_metric();
+  VEC_DESTROY(v);
+  free(dmin);
+  free(dmax);
+  free_csr_graph(&g);
+}
+
+int main(void)
+{
+  uint64_t seed;
+
+  seed = 20146;
+  check_graph(1, 1, 1, &seed);
+  check_graph(5, 3, 2, &seed);
+  check_graph(40, 70, 3, &seed);
+  check_graph(200, 150, 1, &seed);
+  check_graph(300, 200, 4, &seed);
+  printf("check_batch: ok\n");
+  return EXIT_SUCCESS;
+}
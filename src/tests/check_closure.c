@@ -0,0 +1,141 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the lists of ancestors and the bit rows against brute force LCA
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "CA.h"
+#include "closure.h"
+#include "dag.h"
+
+/**
+ * The list of ancestors of t must have every node that reaches t, by
+ * increasing id, with its shortest distance to t
+ */
+static void check_ancestors(const struct ancestors *a, const long *dmin, long n, long t)
+{
+  long u, i;
+
+  i = 0;
+  for (u = 0; u < n; u++) {
+    if (dmin[u*n + t] == CHECK_INFTY) {
+      if (ancestor_dist(a, u) != -1)
+        fatal("ancestor_dist(%ld, %ld) is %ld for a node that is not an ancestor\n",
+              t, u, ancestor_dist(a, u));
+      continue;
+    }
+    if ((i >= (long)VEC_SIZE(a->node)) || (VEC_GET(a->node, i) != u)
+        || (VEC_GET(a->dist, i) != dmin[u*n + t]) || (ancestor_dist(a, u) != dmin[u*n + t]))
+      fatal("Wrong ancestor %ld of %ld\n", u, t);
+    i++;
+  }
+  if (i != (long)VEC_SIZE(a->node))
+    fatal("The node %ld has %zu ancestors instead of %ld\n", t, VEC_SIZE(a->node), i);
+}
+
+/**
+ * LCA_CA, LCA_CA_SET, closure_lca and closure_lca_set of the pairs of
+ * the k terms
+ */
+static void check_pairs(struct ancestors **anc, const struct closure *tc,
+                        const long *terms, long k, const long *dmin, const long *depth,
+                        long n)
+{
+  long i, j, x, y, lca, dax, day, l, lx, ly;
+  VEC(long) want, set, *s;
+
+  VEC_INIT(long, want);
+  VEC_INIT(long, set);
+  for (i = 0; i < k; i++) {
+    for (j = i; j < k; j++) {
+      x = terms[i];
+      y = terms[j];
+      lca = brute_lca(dmin, depth, n, x, y, &want);
+      l = LCA_CA(anc[x], anc[y], depth, &dax, &day);
+      if ((l != lca) || (dax != dmin[lca*n + x]) || (day != dmin[lca*n + y]))
+        fatal("LCA_CA(%ld, %ld) is %ld at %ld and %ld instead of %ld at %ld and %ld\n",
+              x, y, l, dax, day, lca, dmin[lca*n + x], dmin[lca*n + y]);
+      s = LCA_CA_SET(anc[x], anc[y], depth, &l, &lx, &ly);
+      if ((l != lca) || (lx != dax) || (ly != day))
+        fatal("LCA_CA_SET(%ld, %ld) gives the LCA %ld instead of %ld\n", x, y, l, lca);
+      check_lca_set("LCA_CA_SET", x, y, s, &want);
+      VEC_DESTROY(*s);
+      free(s);
+      if (closure_lca(tc, x, y) != lca)
+        fatal("closure_lca(%ld, %ld) is %ld instead of %ld\n", x, y,
+              closure_lca(tc, x, y), lca);
+      closure_lca_set(tc, x, y, depth, &set);
+      check_lca_set("closure_lca_set", x, y, &set, &want);
+    }
+  }
+  VEC_DESTROY(want);
+  VEC_DESTROY(set);
+}
+
+static void check_graph(long n, long max_parents, long max_cost, uint64_t *seed)
+{
+  long i, k;
+  long *dmin, *dmax, *terms;
+  struct csr_graph g, gi;
+  struct ancestors **anc;
+  struct closure tc;
+
+  random_dag(&g, n, max_parents, max_cost, seed);
+  csr_reverse(&g, &gi);
+  dmin = brute_min_dist(&g);
+  dmax = brute_max_dist(&g);
+  terms = random_order(n, seed);
+  k = 1 + n/2;
+  anc = (struct ancestors **)xcalloc(n, sizeof(struct ancestors *));
+  for (i = 0; i < k; i++) {
+    anc[terms[i]] = get_ancestors(&gi, terms[i]);
+    check_ancestors(anc[terms[i]], dmin, n, terms[i]);
+  }
+  /* The row of depths from the root is the depth of every node */
+  build_closure(&tc, anc, terms, k, dmax, n);
+  for (i = 0; i < n; i++) {
+    if ((tc.row[i] == -1) != (anc[i] == NULL))
+      fatal("The node %ld has a wrong row in the closure\n", i);
+  }
+  if ((k < n) && (closure_lca(&tc, terms[0], terms[k]) != -1))
+    fatal("closure_lca of a node without a row is not -1\n");
+  check_pairs(anc, &tc, terms, k, dmin, dmax, n);
+  free_closure(&tc);
+  for (i = 0; i < k; i++)
+    free_ancestors(anc[terms[i]]);
+  free(anc);
+  free(terms);
+  free(dmin);
+  free(dmax);
+  free_csr_graph(&gi);
+  free_csr_graph(&g);
+}
+
+int main(void)
+{
+  static const long sizes[] = {1, 2, 9, 70, 260};
+  long i, p;
+  uint64_t seed;
+
+  seed = 20143;
+  for (i = 0; i < (long)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    for (p = 1; p <= 4; p += 3) {
+      check_graph(sizes[i], p, 1, &seed);
+      check_graph(sizes[i], p, 4, &seed);
+    }
+  }
+  printf("check_closure: ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the distance searches against the brute force distances
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "apsp.h"
+#include "dag.h"
+
+/**
+ * min_distance, min_paths, max_distance and calculate_root_distances
+ * of every pair of g, against the brute force distances
+ */
+static void check_searches(const struct csr_graph *g, const long *dmin, const long *dmax)
+{
+  long n, s, t;
+  long *goals, *dist, *root_min, *root_max;
+  struct search_ctx sc;
+
+  n = g->n_nodes;
+  init_search_ctx(&sc, n);
+  goals = (long *)xmalloc(n*sizeof(long));
+  dist = (long *)xmalloc(n*sizeof(long));
+  for (t = 0; t < n; t++)
+    goals[t] = t;
+  for (s = 0; s < n; s++) {
+    min_paths(g, s, goals, n, dist, &sc);
+    for (t = 0; t < n; t++) {
+      if (dist[t] != dmin[s*n + t])
+        fatal("min_paths(%ld, %ld) is %ld instead of %ld\n", s, t, dist[t], dmin[s*n + t]);
+      if (min_distance(g, s, t, &sc) != dmin[s*n + t])
+        fatal("min_distance(%ld, %ld) is %ld instead of %ld\n", s, t,
+              min_distance(g, s, t, &sc), dmin[s*n + t]);
+      if (max_distance(g, s, t, &sc) != dmax[s*n + t])
+        fatal("max_distance(%ld, %ld) is %ld instead of %ld\n", s, t,
+              max_distance(g, s, t, &sc), dmax[s*n + t]);
+    }
+  }
+  root_min = (long *)xmalloc(n*sizeof(long));
+  root_max = (long *)xmalloc(n*sizeof(long));
+  calculate_root_distances(g, root_min, root_max);
+  for (t = 0; t < n; t++) {
+    if ((root_min[t] != dmin[t]) || (root_max[t] != dmax[t]))
+      fatal("The distances from the root to %ld are %ld and %ld instead of %ld and %ld\n",
+            t, root_min[t], root_max[t], dmin[t], dmax[t]);
+  }
+  free(root_min);
+  free(root_max);
+  free(goals);
+  free(dist);
+  free_search_ctx(&sc);
+}
+
+/**
+ * apsp_all with n_threads threads, against the brute force distances
+ */
+static void check_apsp(const struct csr_graph *g, const long *dmin, unsigned n_threads)
+{
+  long n, s, t;
+  struct dist_matrix m;
+
+  n = g->n_nodes;
+  apsp_all(g, &m, n_threads);
+  for (s = 0; s < n; s++) {
+    for (t = 0; t < n; t++) {
+      if (dist_matrix_get(&m, s, t) != dmin[s*n + t])
+        fatal("apsp_all(%ld, %ld) is %ld instead of %ld with %u threads\n", s, t,
+              dist_matrix_get(&m, s, t), dmin[s*n + t], n_threads);
+    }
+  }
+  free_dist_matrix(&m);
+}
+
+int main(void)
+{
+  static const long sizes[] = {1, 2, 7, 65, 200};
+  long i, cost;
+  long *dmin, *dmax;
+  uint64_t seed;
+  struct csr_graph g;
+
+  seed = 20141;
+  for (i = 0; i < (long)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    for (cost = 1; cost <= 3; cost += 2) {
+      random_dag(&g, sizes[i], 3, cost, &seed);
+      dmin = brute_min_dist(&g);
+      dmax = brute_max_dist(&g);
+      check_searches(&g, dmin, dmax);
+      check_apsp(&g, dmin, 1);
+      check_apsp(&g, dmin, 3);
+      free(dmin);
+      free(dmax);
+      free_csr_graph(&g);
+    }
+  }
+  printf("check_distance: ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,382 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the loader of the ontology files against a naive parse
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "arena.h"
+#include "input.h"
+#include "dag.h"
+
+#define MAX_LINE     512
+#define MAX_TEXT     128
+#define MAX_PARENTS  3L
+
+/**
+ * Ontology read line by line with stdio. The roots are solved in the
+ * same way as the loader, from the degrees of the terms of the file.
+ */
+struct naive_ontology {
+  long n_nodes;
+  long n_arcs;
+  char **name;
+  char **desc;
+  struct edge *arcs;
+  long n_annt;
+  long *annt;
+};
+
+/**
+ * Name of a term with its position in the file
+ */
+struct named {
+  const char *name;
+  long pos;
+};
+
+static int named_cmp(const void *a, const void *b)
+{
+  return strcmp(((const struct named *)a)->name, ((const struct named *)b)->name);
+}
+
+static int arc_cmp(const void *a, const void *b)
+{
+  const struct edge *x = (const struct edge *)a;
+  const struct edge *y = (const struct edge *)b;
+
+  if (x->from != y->from)
+    return (x->from > y->from) - (x->from < y->from);
+  if (x->to != y->to)
+    return (x->to > y->to) - (x->to < y->to);
+  return (x->cost > y->cost) - (x->cost < y->cost);
+}
+
+/**
+ * Random text of letters and spaces of at least one character
+ */
+static void random_text(char *buf, unsigned max_len, uint64_t *seed)
+{
+  unsigned i, len;
+  static const char letters[] = "abcdefghijklmnopqrstuvwxyz ,.-";
+
+  len = 1 + check_rand(seed) % max_len;
+  for (i = 0; i < len; i++)
+    buf[i] = letters[check_rand(seed) % (sizeof(letters) - 1)];
+  buf[len] = '\0';
+}
+
+/**
+ * Files of an ontology of n terms whose first n_roots terms have no
+ * parents, and n_annt annotations. The terms and the arcs are written
+ * in a random order. The last line of the files has no newline when
+ * last_newline is false.
+ */
+static void write_ontology(const char *graph_file, const char *desc_file,
+                           const char *annt_file, long n, long n_roots, long n_annt,
+                           bool last_newline, uint64_t *seed)
+{
+  long i, m, v, p, n_parents, *order, *arc_order;
+  char buf[MAX_TEXT], **name;
+  struct edge *arcs;
+  FILE *f;
+
+  order = random_order(n, seed);
+  name = (char **)xmalloc(n*sizeof(char *));
+  for (v = 0; v < n; v++) {
+    random_text(buf, 20, seed);
+    name[v] = (char *)xmalloc(MAX_LINE);
+    snprintf(name[v], MAX_LINE, "GO:%07ld%s", order[v], buf);
+  }
+  f = fopen(desc_file, "w");
+  fprintf(f, "%ld\n", n);
+  for (i = 0; i < n; i++) {
+    random_text(buf, 80, seed);
+    fprintf(f, "%s\t%s%s", name[order[i]], buf, (last_newline || (i < n - 1)) ? "\n" : "");
+  }
+  fclose(f);
+  arcs = (struct edge *)xmalloc((n*MAX_PARENTS + 1)*sizeof(struct edge));
+  m = 0;
+  for (v = n_roots; v < n; v++) {
+    n_parents = 1 + check_rand(seed) % MIN(MAX_PARENTS, v);
+    for (p = 0; p < n_parents; p++) {
+      set_edge(&arcs[m], m, check_rand(seed) % v, v, 1 + check_rand(seed) % 9);
+      m++;
+    }
+  }
+  arc_order = random_order(m, seed);
+  f = fopen(graph_file, "w");
+  fprintf(f, "%ld\t%ld\n", n, m);
+  for (i = 0; i < m; i++) {
+    fprintf(f, "%s\t%s\t%ld%s", name[arcs[arc_order[i]].from], name[arcs[arc_order[i]].to],
+            arcs[arc_order[i]].cost, (last_newline || (i < m - 1)) ? "\n" : "");
+  }
+  fclose(f);
+  f = fopen(annt_file, "w");
+  fprintf(f, "%ld\n", n_annt);
+  for (i = 0; i < n_annt; i++)
+    fprintf(f, "%s%s", name[check_rand(seed) % n], (last_newline || (i < n_annt - 1)) ? "\n" : "");
+  fclose(f);
+  for (v = 0; v < n; v++)
+    free(name[v]);
+  free(name);
+  free(arcs);
+  free(arc_order);
+  free(order);
+}
+
+static void read_line(FILE *f, char *buf)
+{
+  size_t len;
+
+  if (!fgets(buf, MAX_LINE, f))
+    fatal("Unexpected end of a file of the check\n");
+  len = strlen(buf);
+  if ((len > 0) && (buf[len - 1] == '\n'))
+    buf[len - 1] = '\0';
+}
+
+/**
+ * Position in the file of the term with the name s, with a binary
+ * search in the n names of sorted
+ */
+static long naive_find(const struct named *sorted, long n, const char *s)
+{
+  struct named key, *r;
+
+  key.name = s;
+  r = (struct named *)bsearch(&key, sorted, n, sizeof(struct named), named_cmp);
+  if (!r)
+    fatal("The name %s is not in the terms of the check\n", s);
+  return r->pos;
+}
+
+static inline long naive_swap(long u, long a, long b)
+{
+  return (u == a) ? b : ((u == b) ? a : u);
+}
+
+static void naive_load(struct naive_ontology *o, const char *graph_file,
+                       const char *desc_file, const char *annt_file, bool description)
+{
+  long i, n, m, *din, *dout, n_roots, root;
+  char buf[MAX_LINE], *tab, *tab2, **tmp;
+  struct named *sorted;
+  FILE *f;
+
+  f = fopen(desc_file, "r");
+  read_line(f, buf);
+  n = strtol(buf, NULL, 10);
+  o->name = (char **)xmalloc((n + 1)*sizeof(char *));
+  o->desc = (char **)xmalloc((n + 1)*sizeof(char *));
+  for (i = 0; i < n; i++) {
+    read_line(f, buf);
+    tab = strchr(buf, '\t');
+    *tab = '\0';
+    o->name[i] = strdup(buf);
+    o->desc[i] = strdup(description ? tab + 1 : buf);
+  }
+  fclose(f);
+  /* The names sorted, with their positions in the file */
+  sorted = (struct named *)xmalloc((n + 1)*sizeof(struct named));
+  for (i = 0; i < n; i++) {
+    sorted[i].name = o->name[i];
+    sorted[i].pos = i;
+  }
+  qsort(sorted, n, sizeof(struct named), named_cmp);
+  o->n_nodes = n;
+  f = fopen(graph_file, "r");
+  read_line(f, buf);
+  m = strtol(strchr(buf, '\t') + 1, NULL, 10);
+  o->arcs = (struct edge *)xmalloc((m + n + 1)*sizeof(struct edge));
+  for (i = 0; i < m; i++) {
+    read_line(f, buf);
+    tab = strchr(buf, '\t');
+    *tab = '\0';
+    tab2 = strchr(tab + 1, '\t');
+    *tab2 = '\0';
+    set_edge(&o->arcs[i], i, naive_find(sorted, n, buf), naive_find(sorted, n, tab + 1),
+             strtol(tab2 + 1, NULL, 10));
+  }
+  fclose(f);
+  f = fopen(annt_file, "r");
+  read_line(f, buf);
+  o->n_annt = strtol(buf, NULL, 10);
+  o->annt = (long *)xmalloc((o->n_annt + 1)*sizeof(long));
+  for (i = 0; i < o->n_annt; i++) {
+    read_line(f, buf);
+    o->annt[i] = naive_find(sorted, n, buf);
+  }
+  fclose(f);
+  /* The single root goes to 0, or a new root is added at 0 */
+  din = (long *)xcalloc(n + 1, sizeof(long));
+  dout = (long *)xcalloc(n + 1, sizeof(long));
+  for (i = 0; i < m; i++) {
+    dout[o->arcs[i].from]++;
+    din[o->arcs[i].to]++;
+  }
+  n_roots = 0;
+  root = -1;
+  for (i = 0; i < n; i++) {
+    if ((din[i] == 0) && (dout[i] > 0)) {
+      n_roots++;
+      root = i;
+    }
+  }
+  if (n_roots == 1) {
+    for (i = 0; i < m; i++) {
+      o->arcs[i].from = naive_swap(o->arcs[i].from, 0, root);
+      o->arcs[i].to = naive_swap(o->arcs[i].to, 0, root);
+    }
+    for (i = 0; i < o->n_annt; i++)
+      o->annt[i] = naive_swap(o->annt[i], 0, root);
+    SWAP(o->name[0], o->name[root]);
+    SWAP(o->desc[0], o->desc[root]);
+  } else {
+    for (i = 0; i < m; i++) {
+      o->arcs[i].from++;
+      o->arcs[i].to++;
+    }
+    for (i = 0; i < o->n_annt; i++)
+      o->annt[i]++;
+    for (i = 0; i < n; i++) {
+      if ((din[i] == 0) && (dout[i] > 0)) {
+        set_edge(&o->arcs[m], m, 0, i + 1, 1);
+        m++;
+      }
+    }
+    tmp = o->name;
+    o->name = (char **)xmalloc((n + 2)*sizeof(char *));
+    o->name[0] = strdup("ROOT");
+    memcpy(o->name + 1, tmp, n*sizeof(char *));
+    free(tmp);
+    tmp = o->desc;
+    o->desc = (char **)xmalloc((n + 2)*sizeof(char *));
+    o->desc[0] = strdup("Ontology Root");
+    memcpy(o->desc + 1, tmp, n*sizeof(char *));
+    free(tmp);
+    o->n_nodes = n + 1;
+  }
+  o->n_arcs = m;
+  free(din);
+  free(dout);
+  free(sorted);
+}
+
+static void free_naive(struct naive_ontology *o)
+{
+  long i;
+
+  for (i = 0; i < o->n_nodes; i++) {
+    free(o->name[i]);
+    free(o->desc[i]);
+  }
+  free(o->name);
+  free(o->desc);
+  free(o->arcs);
+  free(o->annt);
+}
+
+/**
+ * Compare the graph, the descriptions and the annotations given by the
+ * loader with n_threads threads with the naive parse
+ */
+static void compare(const struct input_data *in, const struct naive_ontology *o,
+                    unsigned n_threads)
+{
+  long u, k, m;
+  struct edge *arcs;
+
+  if (in->g.n_nodes != o->n_nodes)
+    fatal("%u threads: %ld nodes instead of %ld\n", n_threads, in->g.n_nodes, o->n_nodes);
+  if (in->g.n_edges != o->n_arcs)
+    fatal("%u threads: %ld arcs instead of %ld\n", n_threads, in->g.n_edges, o->n_arcs);
+  arcs = (struct edge *)xmalloc((o->n_arcs + 1)*sizeof(struct edge));
+  m = 0;
+  for (u = 0; u < in->g.n_nodes; u++) {
+    csr_for_each_out(k, &in->g, u) {
+      set_edge(&arcs[m], m, u, in->g.out_to[k], in->g.out_cost[k]);
+      m++;
+    }
+  }
+  qsort(arcs, m, sizeof(struct edge), arc_cmp);
+  qsort(o->arcs, o->n_arcs, sizeof(struct edge), arc_cmp);
+  for (k = 0; k < m; k++) {
+    if (arc_cmp(&arcs[k], &o->arcs[k]) != 0)
+      fatal("%u threads: the arc %ld is (%ld, %ld, %ld) instead of (%ld, %ld, %ld)\n",
+            n_threads, k, arcs[k].from, arcs[k].to, arcs[k].cost,
+            o->arcs[k].from, o->arcs[k].to, o->arcs[k].cost);
+  }
+  for (u = 0; u < o->n_nodes; u++) {
+    if (strcmp(str_arena_get(&in->strings, in->descriptions[u]), o->desc[u]) != 0)
+      fatal("%u threads: the description of %ld is \"%s\" instead of \"%s\"\n", n_threads,
+            u, str_arena_get(&in->strings, in->descriptions[u]), o->desc[u]);
+  }
+  if ((long)VEC_SIZE(in->anntt) != o->n_annt)
+    fatal("%u threads: %ld annotations instead of %ld\n", n_threads,
+          (long)VEC_SIZE(in->anntt), o->n_annt);
+  for (k = 0; k < o->n_annt; k++) {
+    if (VEC_GET(in->anntt, k) != o->annt[k])
+      fatal("%u threads: the annotation %ld is %ld instead of %ld\n", n_threads, k,
+            VEC_GET(in->anntt, k), o->annt[k]);
+  }
+  free(arcs);
+}
+
+static void check_loader(const char *dir, long n, long n_roots, long n_annt,
+                         bool last_newline, uint64_t *seed)
+{
+  char graph_file[MAX_LINE], desc_file[MAX_LINE], annt_file[MAX_LINE];
+  unsigned t, d;
+  struct naive_ontology o;
+  struct input_data in;
+  static const unsigned n_threads[] = {1, 2, 7};
+
+  snprintf(graph_file, MAX_LINE, "%s/graph.txt", dir);
+  snprintf(desc_file, MAX_LINE, "%s/terms.txt", dir);
+  snprintf(annt_file, MAX_LINE, "%s/annotations.txt", dir);
+  write_ontology(graph_file, desc_file, annt_file, n, n_roots, n_annt, last_newline, seed);
+  for (d = 0; d < 2; d++) {
+    naive_load(&o, graph_file, desc_file, annt_file, d);
+    for (t = 0; t < sizeof(n_threads)/sizeof(n_threads[0]); t++) {
+      in = get_input_ontology_data(graph_file, desc_file, annt_file, d, n_threads[t]);
+      compare(&in, &o, n_threads[t]);
+      free_input_data(&in);
+    }
+    free_naive(&o);
+  }
+  unlink(graph_file);
+  unlink(desc_file);
+  unlink(annt_file);
+}
+
+int main(void)
+{
+  uint64_t seed;
+  char dir[] = "/tmp/check_input_XXXXXX";
+
+  if (!mkdtemp(dir))
+    fatal("Error creating the directory of the check\n");
+  seed = 3331;
+  check_loader(dir, 2, 1, 3, true, &seed);
+  check_loader(dir, 9, 1, 9, false, &seed);
+  check_loader(dir, 30, 4, 50, true, &seed);
+  check_loader(dir, 40000, 1, 1000, true, &seed);
+  check_loader(dir, 40000, 7, 1000, false, &seed);
+  rmdir(dir);
+  printf("check_input: ok\n");
+  return EXIT_SUCCESS;
+}
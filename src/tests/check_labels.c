@@ -0,0 +1,88 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the 2-hop labels against the brute force distances
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "labels.h"
+#include "dag.h"
+
+/**
+ * The entries [s, e) of a label must be sorted by rank, without repeats
+ */
+static void check_sorted(const int32_t *hub, long s, long e, long v)
+{
+  long i;
+
+  for (i = s + 1; i < e; i++) {
+    if (hub[i-1] >= hub[i])
+      fatal("The label of %ld is not sorted by rank\n", v);
+  }
+}
+
+static void check_graph(long n, long max_parents, long max_cost, uint64_t *seed)
+{
+  long s, t;
+  long *dmin, *dmax;
+  bool *ranked;
+  struct csr_graph g;
+  struct hop_labels hl;
+
+  random_dag(&g, n, max_parents, max_cost, seed);
+  dmin = brute_min_dist(&g);
+  dmax = brute_max_dist(&g);
+  build_hop_labels(&hl, &g, dmax);
+  ranked = (bool *)xcalloc(n, sizeof(bool));
+  for (s = 0; s < n; s++) {
+    if ((hl.hub_node[s] < 0) || (hl.hub_node[s] >= n) || ranked[hl.hub_node[s]])
+      fatal("The hubs are not a permutation of the nodes\n");
+    ranked[hl.hub_node[s]] = true;
+    check_sorted(hl.out_hub, hl.out_offset[s], hl.out_offset[s+1], s);
+    check_sorted(hl.in_hub, hl.in_offset[s], hl.in_offset[s+1], s);
+  }
+  set_distance_labels(&g, &hl);
+  for (s = 0; s < n; s++) {
+    for (t = 0; t < n; t++) {
+      if (hop_distance(&hl, s, t) != dmin[s*n + t])
+        fatal("hop_distance(%ld, %ld) is %ld instead of %ld\n", s, t,
+              hop_distance(&hl, s, t), dmin[s*n + t]);
+      if (min_distance(&g, s, t, NULL) != dmin[s*n + t])
+        fatal("min_distance(%ld, %ld) with the labels is %ld instead of %ld\n", s, t,
+              min_distance(&g, s, t, NULL), dmin[s*n + t]);
+    }
+  }
+  set_distance_labels(NULL, NULL);
+  free(ranked);
+  free_hop_labels(&hl);
+  free(dmin);
+  free(dmax);
+  free_csr_graph(&g);
+}
+
+int main(void)
+{
+  static const long sizes[] = {1, 2, 8, 60, 250};
+  long i;
+  uint64_t seed;
+
+  seed = 20148;
+  for (i = 0; i < (long)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    check_graph(sizes[i], 1, 1, &seed);
+    check_graph(sizes[i], 3, 1, &seed);
+    check_graph(sizes[i], 4, 6, &seed);
+  }
+  printf("check_labels: ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,98 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the LCA of the packed ancestors against brute force LCA
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "CA.h"
+#include "pack.h"
+#include "dag.h"
+
+/**
+ * packed_lca of the pairs of the k terms, with and without the set.
+ * The costs up to max_cost give distances of several bytes.
+ */
+static void check_graph(long n, long max_parents, long max_cost, uint64_t *seed)
+{
+  long i, j, k, x, y, lca, l, dax, day, max_size;
+  long *dmin, *dmax, *terms;
+  struct csr_graph g, gi;
+  struct ancestors *a;
+  struct packed_ancestors **packed;
+  VEC(long) want, set;
+
+  random_dag(&g, n, max_parents, max_cost, seed);
+  csr_reverse(&g, &gi);
+  dmin = brute_min_dist(&g);
+  dmax = brute_max_dist(&g);
+  terms = random_order(n, seed);
+  k = 1 + n/3;
+  packed = (struct packed_ancestors **)xcalloc(n, sizeof(struct packed_ancestors *));
+  max_size = 0;
+  for (i = 0; i < k; i++) {
+    a = get_ancestors(&gi, terms[i]);
+    packed[terms[i]] = pack_ancestors(a);
+    if (packed[terms[i]]->size != (long)VEC_SIZE(a->node))
+      fatal("The packed list of %ld has %ld entries instead of %zu\n", terms[i],
+            packed[terms[i]]->size, VEC_SIZE(a->node));
+    max_size = MAX(max_size, packed[terms[i]]->size);
+    free_ancestors(a);
+  }
+  if ((n > 200) && (max_parents > 1) && (max_size <= PACK_SKIP))
+    fatal("No list of ancestors has a skip point\n");
+  VEC_INIT(long, want);
+  VEC_INIT(long, set);
+  for (i = 0; i < k; i++) {
+    for (j = i; j < k; j++) {
+      x = terms[i];
+      y = terms[j];
+      lca = brute_lca(dmin, dmax, n, x, y, &want);
+      l = packed_lca(packed[x], packed[y], dmax, &dax, &day, NULL);
+      if ((l != lca) || (dax != dmin[lca*n + x]) || (day != dmin[lca*n + y]))
+        fatal("packed_lca(%ld, %ld) is %ld at %ld and %ld instead of %ld at %ld and %ld\n",
+              x, y, l, dax, day, lca, dmin[lca*n + x], dmin[lca*n + y]);
+      VEC_CLEAR(set);
+      if (packed_lca(packed[x], packed[y], dmax, &dax, &day, &set) != lca)
+        fatal("packed_lca(%ld, %ld) with the set does not give %ld\n", x, y, lca);
+      check_lca_set("packed_lca", x, y, &set, &want);
+    }
+  }
+  VEC_DESTROY(want);
+  VEC_DESTROY(set);
+  for (i = 0; i < k; i++)
+    free_packed_ancestors(packed[terms[i]]);
+  free(packed);
+  free(terms);
+  free(dmin);
+  free(dmax);
+  free_csr_graph(&gi);
+  free_csr_graph(&g);
+}
+
+int main(void)
+{
+  static const long sizes[] = {1, 2, 9, 70, 400};
+  long i;
+  uint64_t seed;
+
+  seed = 20144;
+  for (i = 0; i < (long)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    check_graph(sizes[i], 1, 1, &seed);
+    check_graph(sizes[i], 4, 1, &seed);
+    check_graph(sizes[i], 4, 300, &seed);
+  }
+  printf("check_pack: ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the position of the pairs against the nested loop
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "arena.h"
+#include "tax_sim.h"
+#include "dag.h"
+
+static void check_pair(uint64_t p, uint64_t n, uint64_t i, uint64_t j)
+{
+  uint64_t pi, pj;
+
+  pair_of_index(p, n, &pi, &pj);
+  if ((pi != i) || (pj != j))
+    fatal("pair_of_index(%lu) of %lu terms is (%lu, %lu) instead of (%lu, %lu)\n",
+          (unsigned long)p, (unsigned long)n, (unsigned long)pi, (unsigned long)pj,
+          (unsigned long)i, (unsigned long)j);
+}
+
+/**
+ * Every pair of the nested loop over the i <= j of n terms
+ */
+static void check_all_pairs(uint64_t n)
+{
+  uint64_t i, j, p;
+
+  p = 0;
+  for (i = 0; i < n; i++) {
+    for (j = i; j < n; j++) {
+      check_pair(p, n, i, j);
+      p++;
+    }
+  }
+}
+
+/**
+ * The first pair of every chunk of random size, as the threads take
+ * them, against the pair reached by the nested loop
+ */
+static void check_chunks(uint64_t n, uint64_t max_chunk, uint64_t *seed)
+{
+  uint64_t i, j, p, next, total;
+
+  total = (n*(n + 1))/2;
+  i = 0;
+  j = 0;
+  next = 0;
+  for (p = 0; p < total; p++) {
+    if (p == next) {
+      check_pair(p, n, i, j);
+      next += 1 + check_rand(seed) % max_chunk;
+    }
+    if (++j == n) {
+      i++;
+      j = i;
+    }
+  }
+}
+
+/**
+ * The first and the last pair of the rows r and n - 1 - r of n terms,
+ * for the rows r multiple of step, where the rounding of the square
+ * root is the largest
+ */
+static void check_rows(uint64_t n, uint64_t step)
+{
+  uint64_t r, i, off;
+
+  for (r = 0; r < n; r += step) {
+    i = r;
+    off = (i*(2*n - i + 1))/2;
+    check_pair(off, n, i, i);
+    check_pair(off + n - 1 - i, n, i, n - 1);
+    i = n - 1 - r;
+    off = (i*(2*n - i + 1))/2;
+    check_pair(off, n, i, i);
+    check_pair(off + n - 1 - i, n, i, n - 1);
+  }
+}
+
+int main(void)
+{
+  uint64_t n, seed;
+
+  seed = 5077;
+  for (n = 1; n <= 70; n++)
+    check_all_pairs(n);
+  check_all_pairs(1000);
+  check_chunks(3001, 64, &seed);
+  check_chunks(2500, 1, &seed);
+  check_chunks(4099, 5000, &seed);
+  check_rows(1000003, 1);
+  check_rows(50000000, 997);
+  check_rows(UINT64_C(3000000000), 10000019);
+  printf("check_pairs: ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the reachability index against the brute force distances
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "reach.h"
+#include "dag.h"
+
+/**
+ * is_ancestor and min_distance_reach of every ordered pair of g
+ */
+static void check_graph(long n, long max_parents, long max_cost, uint64_t *seed)
+{
+  long a, x, d;
+  long *dmin;
+  bool anc;
+  struct csr_graph g;
+  struct reach_index ri;
+  struct search_ctx sc;
+
+  random_dag(&g, n, max_parents, max_cost, seed);
+  dmin = brute_min_dist(&g);
+  build_reach_index(&ri, &g);
+  init_search_ctx(&sc, n);
+  for (a = 0; a < n; a++) {
+    for (x = 0; x < n; x++) {
+      anc = (dmin[a*n + x] != CHECK_INFTY);
+      if (is_ancestor(&ri, a, x) != anc)
+        fatal("is_ancestor(%ld, %ld) is %d instead of %d\n", a, x,
+              is_ancestor(&ri, a, x), anc);
+      d = min_distance_reach(&g, a, x, &ri, &sc);
+      if (d != dmin[a*n + x])
+        fatal("min_distance_reach(%ld, %ld) is %ld instead of %ld\n", a, x, d,
+              dmin[a*n + x]);
+    }
+  }
+  free_search_ctx(&sc);
+  free_reach_index(&ri);
+  free(dmin);
+  free_csr_graph(&g);
+}
+
+int main(void)
+{
+  static const long sizes[] = {1, 2, 9, 80, 300};
+  long i;
+  uint64_t seed;
+
+  seed = 20150;
+  for (i = 0; i < (long)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    check_graph(sizes[i], 1, 1, &seed);
+    check_graph(sizes[i], 2, 3, &seed);
+    check_graph(sizes[i], 5, 1, &seed);
+  }
+  printf("check_reach: ok\n");
+  return EXIT_SUCCESS;
+}
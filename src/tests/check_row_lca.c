@@ -0,0 +1,84 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the row sweep LCA against brute force LCA
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "CA.h"
+#include "metric.h"
+#include "row_lca.h"
+#include "dag.h"
+
+/**
+ * One sweep for each of k annotations taken with repetition from the
+ * nodes of a random ontology, and a query for every annotation of its
+ * row. The workspace is reused by all the sweeps.
+ */
+static void check_graph(long n, long k, long max_parents, uint64_t *seed)
+{
+  long a, i, j, x, y, lca, l, dax, day;
+  long *dmin, *dmax;
+  struct csr_graph g;
+  struct row_lca rows;
+  struct row_lca_ws ws;
+  const struct ancestors *ax;
+  VEC(long) v;
+
+  random_dag(&g, n, max_parents, 3, seed);
+  dmin = brute_min_dist(&g);
+  dmax = brute_max_dist(&g);
+  VEC_INIT(long, v);
+  for (a = 0; a < k; a++)
+    VEC_PUSH(long, v, check_rand(seed) % n);
+  init_metric_data(&g, LCA_MERGE, false);
+  precompute_ancestors(&v, 2, true);
+  build_row_lca(&rows, &g, &v, get_nodes_depth());
+  init_row_lca_ws(&ws, &rows);
+  for (i = 0; i < k; i++) {
+    x = VEC_GET(v, i);
+    ax = metric_ancestors(x);
+    row_lca_sweep(&rows, ax, &ws);
+    for (j = i; j < k; j++) {
+      y = VEC_GET(v, j);
+      lca = brute_lca(dmin, dmax, n, x, y, NULL);
+      l = row_lca_query(&rows, &ws, y, &dax, &day);
+      if ((l != lca) || (dax != dmin[lca*n + x]) || (day != dmin[lca*n + y]))
+        fatal("row_lca_query(%ld, %ld) is %ld at %ld and %ld instead of %ld at %ld and %ld\n",
+              x, y, l, dax, day, lca, dmin[lca*n + x], dmin[lca*n + y]);
+    }
+    row_lca_clear(&rows, ax, &ws);
+  }
+  free_row_lca_ws(&ws);
+  free_row_lca(&rows);
+  free_metric();
+  VEC_DESTROY(v);
+  free(dmin);
+  free(dmax);
+  free_csr_graph(&g);
+}
+
+int main(void)
+{
+  uint64_t seed;
+
+  seed = 20147;
+  check_graph(1, 1, 1, &seed);
+  check_graph(5, 4, 2, &seed);
+  check_graph(40, 60, 3, &seed);
+  check_graph(200, 120, 1, &seed);
+  check_graph(300, 150, 4, &seed);
+  printf("check_row_lca: ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,126 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the map of term names against a linear search
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "arena.h"
+#include "term_map.h"
+#include "dag.h"
+
+#define N_KEYS   5000
+#define MAX_LEN  40
+
+/**
+ * Random string of letters of alphabet in buf, with at most max_len
+ * letters. The short strings repeat often and are prefixes of others.
+ */
+static unsigned random_string(char *buf, const char *alphabet, unsigned max_len,
+                              uint64_t *seed)
+{
+  unsigned i, len, n;
+
+  n = strlen(alphabet);
+  len = check_rand(seed) % (max_len + 1);
+  for (i = 0; i < len; i++)
+    buf[i] = alphabet[check_rand(seed) % n];
+  buf[len] = '\0';
+  return len;
+}
+
+/**
+ * First of the n keys of the arena with the string s of length len, by
+ * a linear search, or -1
+ */
+static long linear_find(const struct str_arena *a, const long *key, const unsigned *len,
+                        long n, const char *s, unsigned l)
+{
+  long i;
+
+  for (i = 0; i < n; i++) {
+    if ((len[i] == l) && (memcmp(str_arena_get(a, key[i]), s, l) == 0))
+      return i;
+  }
+  return -1;
+}
+
+/**
+ * Add N_KEYS random strings, with repeats, to a map sized for n keys,
+ * and compare the results of add, find and the iteration with a
+ * linear search
+ */
+static void check_map(long n, unsigned max_len, uint64_t *seed)
+{
+  long i, k, first, r, n_distinct, count;
+  long key[N_KEYS];
+  unsigned len[N_KEYS], l;
+  char buf[MAX_LEN + 2];
+  struct str_arena a;
+  struct term_map m;
+  struct term_slot *slot;
+
+  init_str_arena(&a, 16);
+  init_term_map(&m, &a, n);
+  n_distinct = 0;
+  for (i = 0; i < N_KEYS; i++) {
+    len[i] = random_string(buf, (i % 2) ? "ab" : "abcdefgh", max_len, seed);
+    key[i] = str_arena_add(&a, buf, len[i]);
+    first = linear_find(&a, key, len, i, buf, len[i]);
+    r = term_map_add(&m, key[i], len[i], i);
+    if (r != first)
+      fatal("term_map_add(\"%s\") is %ld instead of %ld\n", buf, r, first);
+    if (first == -1)
+      n_distinct++;
+  }
+  if (m.size != n_distinct)
+    fatal("The map has %ld keys instead of %ld\n", m.size, n_distinct);
+  count = 0;
+  term_map_for_each(slot, k, &m) {
+    if (slot->value != linear_find(&a, key, len, N_KEYS, str_arena_get(&a, slot->key),
+                                   slot->len))
+      fatal("The slot %ld has the value of a repeated key\n", k);
+    count++;
+  }
+  if (count != n_distinct)
+    fatal("The iteration visits %ld keys instead of %ld\n", count, n_distinct);
+  for (i = 0; i < N_KEYS; i++) {
+    /* The string to find does not end with '\0' */
+    memcpy(buf, str_arena_get(&a, key[i]), len[i]);
+    buf[len[i]] = 'z';
+    r = term_map_find(&m, buf, len[i]);
+    if (r != linear_find(&a, key, len, N_KEYS, buf, len[i]))
+      fatal("term_map_find of the key %ld is %ld\n", i, r);
+    l = random_string(buf, "abcdefghz", max_len + 1, seed);
+    r = term_map_find(&m, buf, l);
+    if (r != linear_find(&a, key, len, N_KEYS, buf, l))
+      fatal("term_map_find(\"%s\") is %ld\n", buf, r);
+  }
+  free_term_map(&m);
+  free_str_arena(&a);
+}
+
+int main(void)
+{
+  uint64_t seed;
+
+  seed = 20149;
+  check_map(1, 6, &seed);
+  check_map(N_KEYS, 6, &seed);
+  check_map(1, MAX_LEN, &seed);
+  check_map(100, 12, &seed);
+  printf("check_term_map: ok\n");
+  return EXIT_SUCCESS;
+}
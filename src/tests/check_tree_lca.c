@@ -0,0 +1,81 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Check the LCA of the euler tour against brute force LCA
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "tree_lca.h"
+#include "dag.h"
+
+/**
+ * The nodes of the tree of a random ontology, where the ids are a
+ * topological order, and tree_lca_query of all their pairs
+ */
+static void check_graph(long n, long max_parents, uint64_t *seed)
+{
+  long u, v, lca, n_tree;
+  long *dmin, *dmax;
+  bool *tree;
+  struct csr_graph g;
+  struct tree_lca tl;
+
+  random_dag(&g, n, max_parents, 3, seed);
+  dmin = brute_min_dist(&g);
+  dmax = brute_max_dist(&g);
+  build_tree_lca(&tl, &g);
+  tree = (bool *)xcalloc(n, sizeof(bool));
+  n_tree = 0;
+  for (u = 0; u < n; u++) {
+    if (u == 0)
+      tree[u] = true;
+    else if (g.in_offset[u+1] - g.in_offset[u] == 1)
+      tree[u] = tree[g.in_from[g.in_offset[u]]];
+    if (in_tree(&tl, u) != tree[u])
+      fatal("in_tree(%ld) is %d instead of %d\n", u, in_tree(&tl, u), tree[u]);
+    n_tree += tree[u];
+  }
+  if ((max_parents == 1) && (n_tree != n))
+    fatal("Only %ld of the %ld nodes of a tree are in the tree\n", n_tree, n);
+  for (u = 0; u < n; u++) {
+    for (v = u; (v < n) && tree[u]; v++) {
+      if (!tree[v])
+        continue;
+      lca = brute_lca(dmin, dmax, n, u, v, NULL);
+      if ((tree_lca_query(&tl, u, v) != lca) || (tree_lca_query(&tl, v, u) != lca))
+        fatal("tree_lca_query(%ld, %ld) is %ld instead of %ld\n", u, v,
+              tree_lca_query(&tl, u, v), lca);
+    }
+  }
+  free(tree);
+  free_tree_lca(&tl);
+  free(dmin);
+  free(dmax);
+  free_csr_graph(&g);
+}
+
+int main(void)
+{
+  static const long sizes[] = {1, 2, 3, 17, 129, 500};
+  long i;
+  uint64_t seed;
+
+  seed = 20145;
+  for (i = 0; i < (long)(sizeof(sizes)/sizeof(sizes[0])); i++) {
+    check_graph(sizes[i], 1, &seed);
+    check_graph(sizes[i], 2, &seed);
+  }
+  printf("check_tree_lca: ok\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,187 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Random ontologies and brute force distances for the checks
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "dag.h"
+
+/**
+ * Ontology of n nodes with root 0. Every other node v has from 1 to
+ * max_parents different parents, all with an id lower than v, and the
+ * arcs cost from 1 to max_cost. So the ids are a topological order.
+ */
+void random_dag(struct csr_graph *g, long n, long max_parents, long max_cost,
+                uint64_t *seed)
+{
+  long v, p, n_parents, u, m, k;
+  bool repeated;
+  struct edge *e;
+
+  e = (struct edge *)xmalloc((n*max_parents + 1)*sizeof(struct edge));
+  m = 0;
+  for (v = 1; v < n; v++) {
+    n_parents = 1 + check_rand(seed) % MIN(max_parents, v);
+    for (p = 0; p < n_parents; p++) {
+      do {
+        u = check_rand(seed) % v;
+        repeated = false;
+        for (k = m - p; k < m; k++) {
+          if (e[k].from == u)
+            repeated = true;
+        }
+      } while (repeated);
+      set_edge(&e[m], m, u, v, 1 + check_rand(seed) % max_cost);
+      m++;
+    }
+  }
+  csr_build_edges(g, n, e, m);
+  free(e);
+}
+
+/**
+ * Matrix of n*n shortest distances of g with the Floyd-Warshall
+ * recurrence, CHECK_INFTY for the pairs without a path
+ */
+long *brute_min_dist(const struct csr_graph *g)
+{
+  long n, i, j, w, k;
+  long *d;
+
+  n = g->n_nodes;
+  d = (long *)xmalloc((n*n + 1)*sizeof(long));
+  for (i = 0; i < n*n; i++)
+    d[i] = CHECK_INFTY;
+  for (i = 0; i < n; i++) {
+    d[i*n + i] = 0;
+    csr_for_each_out(k, g, i) {
+      if (g->out_cost[k] < d[i*n + g->out_to[k]])
+        d[i*n + g->out_to[k]] = g->out_cost[k];
+    }
+  }
+  for (w = 0; w < n; w++) {
+    for (i = 0; i < n; i++) {
+      if (d[i*n + w] == CHECK_INFTY)
+        continue;
+      for (j = 0; j < n; j++) {
+        if ((d[w*n + j] != CHECK_INFTY) && (d[i*n + w] + d[w*n + j] < d[i*n + j]))
+          d[i*n + j] = d[i*n + w] + d[w*n + j];
+      }
+    }
+  }
+  return d;
+}
+
+/**
+ * Matrix of n*n longest distances of g, -1 for the pairs without a
+ * path. The ids of g must be a topological order, as in random_dag.
+ */
+long *brute_max_dist(const struct csr_graph *g)
+{
+  long n, s, v, k, u;
+  long *d;
+
+  n = g->n_nodes;
+  d = (long *)xmalloc((n*n + 1)*sizeof(long));
+  for (s = 0; s < n; s++) {
+    for (v = 0; v < n; v++)
+      d[s*n + v] = -1;
+    d[s*n + s] = 0;
+    for (v = s + 1; v < n; v++) {
+      csr_for_each_in(k, g, v) {
+        u = g->in_from[k];
+        if ((d[s*n + u] != -1) && (d[s*n + u] + g->in_cost[k] > d[s*n + v]))
+          d[s*n + v] = d[s*n + u] + g->in_cost[k];
+      }
+    }
+  }
+  return d;
+}
+
+/**
+ * The n nodes of a graph in random order
+ */
+long *random_order(long n, uint64_t *seed)
+{
+  long u, i, t;
+  long *nodes;
+
+  nodes = (long *)xmalloc((n + 1)*sizeof(long));
+  for (u = 0; u < n; u++)
+    nodes[u] = u;
+  for (u = n - 1; u > 0; u--) {
+    i = check_rand(seed) % (u + 1);
+    t = nodes[u];
+    nodes[u] = nodes[i];
+    nodes[i] = t;
+  }
+  return nodes;
+}
+
+/**
+ * The deepest common ancestor of x and y with the smallest id, from the
+ * brute force shortest distances dmin of a graph with n nodes. When set
+ * is not NULL, it gets all the deepest common ancestors by increasing id.
+ */
+long brute_lca(const long *dmin, const long *depth, long n, long x, long y,
+               VEC(long) *set)
+{
+  long a, lca;
+
+  lca = -1;
+  for (a = 0; a < n; a++) {
+    if ((dmin[a*n + x] == CHECK_INFTY) || (dmin[a*n + y] == CHECK_INFTY))
+      continue;
+    if ((lca == -1) || (depth[a] > depth[lca]))
+      lca = a;
+  }
+  if (set) {
+    VEC_CLEAR(*set);
+    for (a = 0; a < n; a++) {
+      if ((dmin[a*n + x] != CHECK_INFTY) && (dmin[a*n + y] != CHECK_INFTY)
+          && (depth[a] == depth[lca]))
+        VEC_PUSH(long, *set, a);
+    }
+  }
+  return lca;
+}
+
+static int long_cmp(const void *a, const void *b)
+{
+  long x = *(const long *)a;
+  long y = *(const long *)b;
+
+  return (x > y) - (x < y);
+}
+
+/**
+ * Compare the LCA set of x and y given by what, in any order, with the
+ * set want in increasing order. set is sorted.
+ */
+void check_lca_set(const char *what, long x, long y, VEC(long) *set,
+                   const VEC(long) *want)
+{
+  size_t i;
+
+  qsort(set->data, VEC_SIZE(*set), sizeof(long), long_cmp);
+  if (VEC_SIZE(*set) != VEC_SIZE(*want))
+    fatal("%s(%ld, %ld) has %zu nodes instead of %zu\n", what, x, y,
+          VEC_SIZE(*set), VEC_SIZE(*want));
+  for (i = 0; i < VEC_SIZE(*want); i++) {
+    if (VEC_GET(*set, i) != VEC_GET(*want, i))
+      fatal("%s(%ld, %ld) has the node %ld instead of %ld\n", what, x, y,
+            VEC_GET(*set, i), VEC_GET(*want, i));
+  }
+}
@@ -0,0 +1,40 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief Random ontologies and brute force distances for the checks
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___DAG_H
+#define ___DAG_H
+
+#define CHECK_INFTY  INT_MAX
+
+/**
+ * Next number of the xorshift generator with state s
+ */
+static inline uint64_t check_rand(uint64_t *s)
+{
+  *s ^= *s << 13;
+  *s ^= *s >> 7;
+  *s ^= *s << 17;
+  return *s;
+}
+
+void random_dag(struct csr_graph *g, long n, long max_parents, long max_cost,
+                uint64_t *seed);
+
+long *brute_min_dist(const struct csr_graph *g);
+
+long *brute_max_dist(const struct csr_graph *g);
+
+long *random_order(long n, uint64_t *seed);
+
+long brute_lca(const long *dmin, const long *depth, long n, long x, long y,
+               VEC(long) *set);
+
+void check_lca_set(const char *what, long x, long y, VEC(long) *set,
+                   const VEC(long) *want);
+
+#endif /* ___DAG_H */
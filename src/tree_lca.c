@@ -0,0 +1,112 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief LCA of the tree shaped nodes by range minimum queries
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <limits.h>
+#include <assert.h>
+
+#include "types.h"
+#include "util.h"
+#include "memory.h"
+#include "graph.h"
+#include "tree_lca.h"
+
+#define ROOT  0
+
+/**
+ * Mark the nodes of the tree, visiting the nodes reachable from ROOT
+ * in topological order so the parent of a node is decided before it.
+ */
+static void mark_tree(const struct csr_graph *g, bool *tree)
+{
+  long u, k;
+  struct long_list *tpl, *tmp;
+  struct list_head *pos;
+
+  tpl = topological_sort(g, ROOT);
+  list_for_each(pos, &(tpl->list)) {
+    tmp = list_entry(pos, struct long_list, list);
+    u = tmp->item;
+    if (u == ROOT) {
+      tree[u] = (g->in_offset[u+1] == g->in_offset[u]);
+    } else if (g->in_offset[u+1] - g->in_offset[u] == 1) {
+      k = g->in_offset[u];
+      tree[u] = tree[g->in_from[k]] && (g->in_cost[k] > 0);
+    }
+  }
+  destroy_long_list(tpl);
+  free(tpl);
+}
+
+void build_tree_lca(struct tree_lca *tl, const struct csr_graph *g)
+{
+  long i, u, n, len, a, b;
+  int k;
+  VEC(long) *tour;
+
+  n = g->n_nodes;
+  tl->n_nodes = n;
+  tl->tree = (bool *)xcalloc(n, sizeof(bool));
+  mark_tree(g, tl->tree);
+
+  /* The first tree of the forest is the one of ROOT */
+  tour = get_euler_tour(g);
+  tl->n_tour = VEC_SIZE(*tour);
+  if (tl->n_tour > INT32_MAX)
+    fatal("Error, the euler tour is too large");
+  tl->first = (long *)xmalloc(n*sizeof(long));
+  tl->level = (long *)xmalloc(n*sizeof(long));
+  for (u = 0; u < n; u++) {
+    tl->first[u] = -1;
+  }
+  for (i = 0; i < tl->n_tour; i++) {
+    u = VEC_GET(*tour, i);
+    if (tl->first[u] == -1) {
+      tl->first[u] = i;
+      tl->level[u] = (i == 0) ? 0 : tl->level[VEC_GET(*tour, i-1)] + 1;
+    }
+  }
+
+  tl->n_levels = 1;
+  while ((1L << tl->n_levels) <= tl->n_tour)
+    tl->n_levels++;
+  tl->table = (int32_t **)xmalloc(tl->n_levels*sizeof(int32_t *));
+  tl->table[0] = (int32_t *)xmalloc((tl->n_tour + 1)*sizeof(int32_t));
+  for (i = 0; i < tl->n_tour; i++) {
+    tl->table[0][i] = VEC_GET(*tour, i);
+  }
+  for (k = 1; k < tl->n_levels; k++) {
+    len = tl->n_tour - (1L << k) + 1;
+    tl->table[k] = (int32_t *)xmalloc((len + 1)*sizeof(int32_t));
+    for (i = 0; i < len; i++) {
+      a = tl->table[k-1][i];
+      b = tl->table[k-1][i + (1L << (k-1))];
+      tl->table[k][i] = (tl->level[a] <= tl->level[b]) ? a : b;
+    }
+  }
+  VEC_DESTROY(*tour);
+  free(tour);
+  DEBUG("\n** Euler tour of %ld positions done ** \n", tl->n_tour);
+}
+
+void free_tree_lca(struct tree_lca *tl)
+{
+  int k;
+
+  for (k = 0; k < tl->n_levels; k++) {
+    free(tl->table[k]);
+  }
+  free(tl->table);
+  free(tl->tree);
+  free(tl->first);
+  free(tl->level);
+  tl->n_nodes = 0;
+}
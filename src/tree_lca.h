@@ -0,0 +1,62 @@
+/**
+ * Copyright (C) 2014 Universidad Simón Bolívar
+ *
+ * @brief LCA of the tree shaped nodes by range minimum queries
+ * Copying: GNU GENERAL PUBLIC LICENSE Version 2
+ * @author Guillermo Palma <gpalma@ldc.usb.ve>
+ */
+
+#ifndef ___TREE_LCA_H
+#define ___TREE_LCA_H
+
+#include <stdint.h>
+
+/**
+ * A node is in the tree when it is the root or it has one parent, in
+ * the tree, joined by an arc with positive cost. Its ancestors are then
+ * the path to the root, and the LCA of two nodes of the tree is the
+ * node of smallest level between their first positions in the euler
+ * tour. table[k][i] is the node of smallest level in the positions
+ * [i, i + 2^k) of the tour.
+ */
+struct tree_lca {
+  long n_nodes;
+  bool *tree;
+  long *first;
+  long *level;
+  long n_tour;
+  int n_levels;
+  int32_t **table;
+};
+
+void build_tree_lca(struct tree_lca *tl, const struct csr_graph *g);
+
+void free_tree_lca(struct tree_lca *tl);
+
+static inline bool in_tree(const struct tree_lca *tl, long x)
+{
+  return tl->tree[x];
+}
+
+/**
+ * LCA of the nodes x and y of the tree
+ */
+static inline long tree_lca_query(const struct tree_lca *tl, long x, long y)
+{
+  long i, j, a, b;
+  int k;
+
+  i = tl->first[x];
+  j = tl->first[y];
+  if (i > j) {
+    a = i;
+    i = j;
+    j = a;
+  }
+  k = 63 - __builtin_clzl((unsigned long)(j - i + 1));
+  a = tl->table[k][i];
+  b = tl->table[k][j - (1L << k) + 1];
+  return (tl->level[a] <= tl->level[b]) ? a : b;
+}
+
+#endif /* ___TREE_LCA_H */
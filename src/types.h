@@ -55,6 +55,16 @@ enum metric {
   DPS
 };
 
+/**
+ * Algorithm used to find the lowest common ancestors
+ */
+enum lca_engine {
+  LCA_MERGE,
+  LCA_BITSET,
+  LCA_PACKED,
+  LCA_TREE
+};
+
 void print_long_list(struct long_list *l) ;
 
 void destroy_long_list(struct long_list *l);
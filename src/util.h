@@ -36,6 +36,12 @@
 
 #define ISEVEN(x)     (!((x)&0x01))
 
+/* On x86-64 the SIMD paths are compiled for their target and chosen at run time */
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SIMD_DISPATCH
+#define TARGET(isa)   __attribute__((target(isa)))
+#endif
+
 void fatal(const char *msg, ...);
 
 int error(const char *msg, ...);